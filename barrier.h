@@ -65,4 +65,464 @@ int pthread_barrier_wait(pthread_barrier_t *barrier)
 }
 
 #endif // PTHREAD_BARRIER_H_
-#endif // __APPLE__
\ No newline at end of file
+#endif // __APPLE__
+
+/* Spin-then-block barrier
+ *
+ * Purpose:    A centralized sense-reversing barrier for the phases of a
+ *             sort: arriving threads spin on the shared sense word, and
+ *             only fall back to sleeping in the kernel (a futex on Linux,
+ *             sched_yield elsewhere) once an adaptive spin budget runs out.
+ *
+ * Example:
+ *    spin_barrier b;
+ *    Spin_barrier_init(&b, thread_count);
+ *    Spin_barrier_wait(&b);           // every thread, once per phase
+ *    Spin_barrier_destroy(&b);
+ *
+ * Algorithm:  The last of count arrivals resets remaining and flips sense;
+ *             everyone else waits for sense to differ from the value it
+ *             read on arrival, which cannot change before it arrives, so
+ *             no per-thread sense is needed. A waiter that gives up
+ *             spinning counts itself in sleepers before the futex wait,
+ *             and the releaser only makes the wake call when sleepers is
+ *             nonzero; both sides use sequentially consistent operations,
+ *             so either the waiter sees the new sense or the releaser sees
+ *             the sleeper. A wait that ends while spinning grows the spin
+ *             budget, one that had to sleep halves it.
+ */
+#ifndef SPIN_BARRIER_H_
+#define SPIN_BARRIER_H_
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "spin.h"
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define BARRIER_SPIN_MIN 64
+#define BARRIER_SPIN_MAX (1 << 16)
+
+typedef struct {
+  atomic_int remaining;        // Arrivals still missing this round
+  atomic_int sense;            // Flipped by the last arrival of a round
+  atomic_int sleepers;         // Waiters blocked in the kernel
+  atomic_int spin_limit;       // Current spin budget, adapted per wait
+  int count;
+} spin_barrier;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Spin_barrier_init
+ * Purpose:     Set up a barrier for count threads
+ * In arg:      count
+ * Out arg:     b
+ * Return val:  0, or -1 with errno EINVAL when count is 0
+ */
+static inline int Spin_barrier_init(spin_barrier *b, unsigned int count) {
+  if (count == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  b->count = (int) count;
+  atomic_init(&b->remaining, (int) count);
+  atomic_init(&b->sense, 0);
+  atomic_init(&b->sleepers, 0);
+  atomic_init(&b->spin_limit, BARRIER_SPIN_MAX / 16);
+  return 0;
+}  /* Spin_barrier_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Spin_barrier_destroy
+ * Purpose:     Nothing to release; kept for symmetry with pthreads
+ * In arg:      b
+ */
+static inline int Spin_barrier_destroy(spin_barrier *b) {
+  (void) b;
+  return 0;
+}  /* Spin_barrier_destroy */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Spin_barrier_sleep / Spin_barrier_wake
+ * Purpose:     Block until sense no longer holds old, and wake all such
+ *              sleepers
+ * In arg:      b, old
+ */
+static inline void Spin_barrier_sleep(spin_barrier *b, int old) {
+#ifdef __linux__
+  syscall(SYS_futex, (int *) &b->sense, FUTEX_WAIT_PRIVATE, old, NULL, NULL, 0);
+#else
+  (void) old;
+  sched_yield();
+#endif
+}  /* Spin_barrier_sleep */
+
+static inline void Spin_barrier_wake(spin_barrier *b) {
+#ifdef __linux__
+  syscall(SYS_futex, (int *) &b->sense, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+  (void) b;
+#endif
+}  /* Spin_barrier_wake */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Spin_barrier_wait
+ * Purpose:     Wait until all count threads have arrived
+ * In arg:      b
+ * Return val:  1 in the thread that released the others, 0 elsewhere
+ */
+static inline int Spin_barrier_wait(spin_barrier *b) {
+  int old = atomic_load(&b->sense);
+  unsigned polls = 0;
+  int limit, i;
+
+  if (atomic_fetch_sub(&b->remaining, 1) == 1) {
+    atomic_store_explicit(&b->remaining, b->count, memory_order_relaxed);
+    atomic_store(&b->sense, !old);
+    if (atomic_load(&b->sleepers) > 0) {
+      Spin_barrier_wake(b);
+    }
+    return 1;
+  }
+
+  limit = atomic_load_explicit(&b->spin_limit, memory_order_relaxed);
+  for (i = 0; i < limit; i++) {
+    if (atomic_load_explicit(&b->sense, memory_order_acquire) != old) {
+      if (limit < BARRIER_SPIN_MAX) {
+        atomic_store_explicit(&b->spin_limit, 2 * limit, memory_order_relaxed);
+      }
+      return 0;
+    }
+    Spin_pause(&polls);
+  }
+
+  // Out of budget: sleep, and spin less next time
+  if (limit > BARRIER_SPIN_MIN) {
+    atomic_store_explicit(&b->spin_limit, limit / 2, memory_order_relaxed);
+  }
+  atomic_fetch_add(&b->sleepers, 1);
+  while (atomic_load(&b->sense) == old) {
+    Spin_barrier_sleep(b, old);
+  }
+  atomic_fetch_sub(&b->sleepers, 1);
+  return 0;
+}  /* Spin_barrier_wait */
+
+#endif // SPIN_BARRIER_H_
+
+
+/* Combining tree and dissemination barriers
+ *
+ * Purpose:    Barriers whose latency grows as O(log p) instead of O(p),
+ *             for machines with many cores. Both need the caller's rank
+ *             (0 .. count-1), which must be distinct across the team.
+ *
+ * Example:
+ *    tree_barrier t;
+ *    Tree_barrier_init(&t, thread_count, 0);   // 0: detect NUMA width
+ *    Tree_barrier_wait(&t, rank);
+ *    Tree_barrier_destroy(&t);
+ *
+ *    dissemination_barrier d;
+ *    Dissemination_barrier_init(&d, thread_count);
+ *    Dissemination_barrier_wait(&d, rank);
+ *    Dissemination_barrier_destroy(&d);
+ *
+ * Algorithm:  Tree: arrivals combine up a tree of counters, at most
+ *             BARRIER_FANIN children per node, each node on its own cache
+ *             line. The last arrival at a node resets it and carries on to
+ *             the parent; the one completing the root flips a global sense
+ *             that everyone else spins on. Ranks are grouped numa_width at
+ *             a time (the cores of one NUMA node, assuming threads are
+ *             placed in rank order) and no node below the per-NUMA-node
+ *             roots mixes groups, so only one arrival per NUMA node
+ *             crosses the interconnect.
+ *
+ *             Dissemination (Hensgen, Finkel and Manber): in round k
+ *             thread i signals thread (i + 2^k) mod count and waits for
+ *             the signal from (i - 2^k) mod count, ceil(log2 count) rounds
+ *             in all with no central hot spot. Signals are per round
+ *             counters of episodes rather than sense and parity flags: a
+ *             thread's e-th wait in round k ends once its counter for that
+ *             round has reached e.
+ *
+ *             Both only spin (yielding now and then), so they suit teams
+ *             of at most one thread per core.
+ */
+#ifndef TREE_BARRIER_H_
+#define TREE_BARRIER_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#define BARRIER_FANIN 4
+
+typedef struct {
+  _Alignas(CACHE_LINE) atomic_int remaining;
+  int count;                   // Children: threads or nodes
+  int parent;                  // -1 at the root
+} tree_node;
+
+typedef struct {
+  tree_node *nodes;
+  int *leaf;                   // Leaf node of every rank
+  _Alignas(CACHE_LINE) atomic_int sense;
+} tree_barrier;
+
+typedef struct {
+  _Alignas(CACHE_LINE) atomic_uint value;
+} barrier_flag;
+
+typedef struct {
+  int count, rounds;
+  barrier_flag *flags;         // rounds rows of count signal counters
+  barrier_flag *episode;       // Waits started by each rank
+} dissemination_barrier;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Barrier_spin_until
+ * Purpose:     Spin, yielding now and then, until *word != old
+ * In arg:      word, old
+ */
+static inline void Barrier_spin_until(atomic_int *word, int old) {
+  unsigned polls = 0;
+
+  while (atomic_load_explicit(word, memory_order_acquire) == old) {
+    Spin_pause(&polls);
+  }
+}  /* Barrier_spin_until */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Barrier_numa_width
+ * Purpose:     Online CPUs per NUMA node, from /sys on Linux
+ * Return val:  The width, or the CPU count when it cannot be told
+ */
+static inline int Barrier_numa_width(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int nodes = 0, id;
+  DIR *dir = opendir("/sys/devices/system/node");
+  struct dirent *entry;
+
+  if (cpus < 1) {
+    cpus = 1;
+  }
+  if (dir != NULL) {
+    while ((entry = readdir(dir)) != NULL) {
+      if (sscanf(entry->d_name, "node%d", &id) == 1) {
+        nodes++;
+      }
+    }
+    closedir(dir);
+  }
+  return nodes > 1 ? (int) ((cpus + nodes - 1) / nodes) : (int) cpus;
+}  /* Barrier_numa_width */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Tree_barrier_init
+ * Purpose:     Build the combining tree for count threads
+ * In arg:      count, numa_width (ranks per NUMA node, 0 to detect)
+ * Out arg:     b
+ * Return val:  0, or -1 with errno set (EINVAL or ENOMEM)
+ */
+static inline int Tree_barrier_init(tree_barrier *b, unsigned int count, int numa_width) {
+  int *item, *domain, items = (int) count, next, used = 0, i, j, level;
+
+  if (count == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (numa_width <= 0) {
+    numa_width = Barrier_numa_width();
+  }
+  b->nodes = aligned_alloc(CACHE_LINE, 2 * count * sizeof(tree_node));
+  b->leaf = malloc(count * sizeof(int));
+  item = malloc(count * sizeof(int));
+  domain = malloc(count * sizeof(int));
+  if (b->nodes == NULL || b->leaf == NULL || item == NULL || domain == NULL) {
+    free(b->nodes);
+    free(b->leaf);
+    free(item);
+    free(domain);
+    errno = ENOMEM;
+    return -1;
+  }
+  for (i = 0; i < items; i++) {
+    item[i] = i;
+    domain[i] = i / numa_width;
+  }
+
+  // Each level groups up to BARRIER_FANIN items of one domain under a
+  // new node; once every domain is down to one item, all become one
+  for (level = 0; level == 0 || items > 1; level++) {
+    next = 0;
+    for (i = 0; i < items; i = j) {
+      for (j = i + 1; j < items && j - i < BARRIER_FANIN && domain[j] == domain[i]; j++) {
+      }
+      // A lone item above the leaves moves up unchanged
+      if (level > 0 && j - i == 1 && (i == 0 || domain[i-1] != domain[i]) &&
+          (j == items || domain[j] != domain[i])) {
+        item[next] = item[i];
+        domain[next++] = domain[i];
+        continue;
+      }
+      b->nodes[used].count = j - i;
+      b->nodes[used].parent = -1;
+      atomic_init(&b->nodes[used].remaining, j - i);
+      while (i < j) {
+        if (level == 0) {
+          b->leaf[item[i]] = used;
+        } else {
+          b->nodes[item[i]].parent = used;
+        }
+        i++;
+      }
+      item[next] = used++;
+      domain[next++] = domain[j-1];
+    }
+    items = next;
+    for (i = 1; i < items && domain[i] != domain[i-1]; i++) {
+    }
+    if (i == items) {
+      memset(domain, 0, items * sizeof(int));
+    }
+  }
+  atomic_init(&b->sense, 0);
+  free(item);
+  free(domain);
+  return 0;
+}  /* Tree_barrier_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Tree_barrier_destroy
+ * Purpose:     Release the tree
+ * In arg:      b
+ */
+static inline int Tree_barrier_destroy(tree_barrier *b) {
+  free(b->nodes);
+  free(b->leaf);
+  return 0;
+}  /* Tree_barrier_destroy */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Tree_barrier_wait
+ * Purpose:     Wait until all count threads have arrived
+ * In arg:      b, rank
+ * Return val:  1 in the thread that completed the root, 0 elsewhere
+ */
+static inline int Tree_barrier_wait(tree_barrier *b, int rank) {
+  int old = atomic_load(&b->sense);
+  tree_node *node = &b->nodes[b->leaf[rank]];
+
+  while (atomic_fetch_sub(&node->remaining, 1) == 1) {
+    // Last at this node: nobody touches it again until the release
+    atomic_store_explicit(&node->remaining, node->count, memory_order_relaxed);
+    if (node->parent < 0) {
+      atomic_store(&b->sense, !old);
+      return 1;
+    }
+    node = &b->nodes[node->parent];
+  }
+  Barrier_spin_until(&b->sense, old);
+  return 0;
+}  /* Tree_barrier_wait */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Dissemination_barrier_init
+ * Purpose:     Set up ceil(log2 count) rounds of signal counters
+ * In arg:      count
+ * Out arg:     b
+ * Return val:  0, or -1 with errno set (EINVAL or ENOMEM)
+ */
+static inline int Dissemination_barrier_init(dissemination_barrier *b, unsigned int count) {
+  int i;
+
+  if (count == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  b->count = (int) count;
+  for (b->rounds = 0; (1u << b->rounds) < count; b->rounds++) {
+  }
+  b->flags = aligned_alloc(CACHE_LINE, ((size_t) b->rounds + 1) * count * sizeof(barrier_flag));
+  b->episode = aligned_alloc(CACHE_LINE, count * sizeof(barrier_flag));
+  if (b->flags == NULL || b->episode == NULL) {
+    free(b->flags);
+    free(b->episode);
+    errno = ENOMEM;
+    return -1;
+  }
+  for (i = 0; i < b->rounds * b->count; i++) {
+    atomic_init(&b->flags[i].value, 0);
+  }
+  for (i = 0; i < b->count; i++) {
+    atomic_init(&b->episode[i].value, 0);
+  }
+  return 0;
+}  /* Dissemination_barrier_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Dissemination_barrier_destroy
+ * Purpose:     Release the signal counters
+ * In arg:      b
+ */
+static inline int Dissemination_barrier_destroy(dissemination_barrier *b) {
+  free(b->flags);
+  free(b->episode);
+  return 0;
+}  /* Dissemination_barrier_destroy */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Dissemination_barrier_wait
+ * Purpose:     Wait until all count threads have arrived
+ * In arg:      b, rank
+ * Return val:  1 in rank 0, 0 elsewhere
+ */
+static inline int Dissemination_barrier_wait(dissemination_barrier *b, int rank) {
+  unsigned e = atomic_load_explicit(&b->episode[rank].value, memory_order_relaxed) + 1;
+  unsigned polls;
+  int k, dist;
+  barrier_flag *mine;
+
+  atomic_store_explicit(&b->episode[rank].value, e, memory_order_relaxed);
+  for (k = 0, dist = 1; k < b->rounds; k++, dist *= 2) {
+    atomic_fetch_add_explicit(&b->flags[k * b->count + (rank + dist) % b->count].value,
+        1, memory_order_release);
+    mine = &b->flags[k * b->count + rank];
+    polls = 0;
+    while ((int) (atomic_load_explicit(&mine->value, memory_order_acquire) - e) < 0) {
+      Spin_pause(&polls);
+    }
+  }
+  return rank == 0;
+}  /* Dissemination_barrier_wait */
+
+#endif // TREE_BARRIER_H_
@@ -0,0 +1,137 @@
+/* File:       bench_barrier.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Average latency of one barrier crossing for
+ *             pthread_barrier_t and the spin-then-block, combining tree
+ *             and dissemination barriers of barrier.h, for thread counts
+ *             doubling up to the maximum given.
+ *
+ * Compile:    gcc -O2 -Wall bench_barrier.c -o bench_barrier -lpthread
+ * Run:        bench_barrier [max threads] [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "timer.h"
+#include "barrier.h"
+
+typedef enum {
+  BENCH_PTHREAD, BENCH_SPIN, BENCH_TREE, BENCH_DISSEMINATION, BENCH_KINDS
+} barrier_kind;
+
+static const char *kind_names[BENCH_KINDS] = {
+  "pthread", "spin", "tree", "dissemination"
+};
+
+typedef struct {
+  barrier_kind kind;
+  pthread_barrier_t pthread_b;
+  spin_barrier spin_b;
+  tree_barrier tree_b;
+  dissemination_barrier dissemination_b;
+  int rounds;
+} bench_barrier;
+
+typedef struct {
+  bench_barrier *b;
+  int rank;
+} bench_arg;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Cross
+ * Purpose:     Cross the chosen barrier rounds times
+ * In arg:      arg (bench_arg)
+ * Return val:  Ignored
+ */
+static void *Cross(void *arg) {
+  bench_barrier *b = ((bench_arg *) arg)->b;
+  int rank = ((bench_arg *) arg)->rank;
+  int r;
+
+  for (r = 0; r < b->rounds; r++) {
+    switch (b->kind) {
+    case BENCH_SPIN:
+      Spin_barrier_wait(&b->spin_b);
+      break;
+    case BENCH_TREE:
+      Tree_barrier_wait(&b->tree_b, rank);
+      break;
+    case BENCH_DISSEMINATION:
+      Dissemination_barrier_wait(&b->dissemination_b, rank);
+      break;
+    default:
+      pthread_barrier_wait(&b->pthread_b);
+    }
+  }
+  return NULL;
+}  /* Cross */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Seconds per crossing with thread_count threads
+ * In arg:      thread_count, rounds, kind
+ */
+static double Run(int thread_count, int rounds, barrier_kind kind) {
+  pthread_t *handles = malloc(thread_count * sizeof(pthread_t));
+  bench_arg *args = malloc(thread_count * sizeof(bench_arg));
+  bench_barrier b;
+  double start, finish;
+  int t;
+
+  b.kind = kind;
+  b.rounds = rounds;
+  pthread_barrier_init(&b.pthread_b, NULL, thread_count);
+  Spin_barrier_init(&b.spin_b, thread_count);
+  Tree_barrier_init(&b.tree_b, thread_count, 0);
+  Dissemination_barrier_init(&b.dissemination_b, thread_count);
+  for (t = 0; t < thread_count; t++) {
+    args[t].b = &b;
+    args[t].rank = t;
+  }
+
+  GET_TIME(start);
+  for (t = 1; t < thread_count; t++) {
+    pthread_create(&handles[t], NULL, Cross, &args[t]);
+  }
+  Cross(&args[0]);
+  for (t = 1; t < thread_count; t++) {
+    pthread_join(handles[t], NULL);
+  }
+  GET_TIME(finish);
+
+  pthread_barrier_destroy(&b.pthread_b);
+  Spin_barrier_destroy(&b.spin_b);
+  Tree_barrier_destroy(&b.tree_b);
+  Dissemination_barrier_destroy(&b.dissemination_b);
+  free(args);
+  free(handles);
+  return (finish - start) / rounds;
+}  /* Run */
+
+
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? strtol(argv[1], NULL, 10) : 64;
+  int rounds = argc > 2 ? strtol(argv[2], NULL, 10) : 100000;
+  int t, kind;
+
+  printf("%d rounds, seconds per crossing\n", rounds);
+  printf("threads");
+  for (kind = 0; kind < BENCH_KINDS; kind++) {
+    printf("  %-13s", kind_names[kind]);
+  }
+  printf("\n");
+  for (t = 1; t <= max_threads; t *= 2) {
+    printf("%7d", t);
+    for (kind = 0; kind < BENCH_KINDS; kind++) {
+      printf("  %e", Run(t, rounds, (barrier_kind) kind));
+    }
+    printf("\n");
+  }
+  return 0;
+}  /* main */
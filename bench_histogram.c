@@ -0,0 +1,130 @@
+/* File:       bench_histogram.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Show what false sharing costs the counting pass: every
+ *             thread counts the bucket ids of its block either straight
+ *             into its row of one packed shared array (as raw_dist used
+ *             to be filled) or into a private cache-line aligned
+ *             histogram copied out at the end (as sample_sort does now),
+ *             for thread counts doubling up to the maximum given.
+ *
+ * Compile:    gcc -O2 -Wall bench_histogram.c -o bench_histogram -lpthread
+ * Run:        bench_histogram [max threads] [keys per thread] [buckets]
+ *
+ * Note:       With few buckets the rows are shorter than a cache line, so
+ *             the shared version keeps bouncing lines between cores; run
+ *             under "perf stat -e cache-misses" (or the HITM events of
+ *             perf c2c) to see the coherence traffic behind the times.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "timer.h"
+#include "spin.h"
+
+typedef struct {
+  const uint16_t *ids;   // This thread's bucket ids
+  size_t n;
+  int bucket_count;
+  size_t *row;           // This thread's row of the shared array
+  int private_counts;
+  pthread_barrier_t *barrier;
+} count_arg;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Count
+ * Purpose:     One thread's counting pass, after all threads are ready
+ * In arg:      arg (count_arg)
+ * Return val:  Ignored
+ */
+static void *Count(void *arg) {
+  count_arg *a = arg;
+  size_t bytes = (a->bucket_count * sizeof(size_t) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+  size_t *hist = a->row, i;
+
+  if (a->private_counts) {
+    hist = aligned_alloc(CACHE_LINE, bytes);
+    memset(hist, 0, bytes);
+  }
+  pthread_barrier_wait(a->barrier);
+  for (i = 0; i < a->n; i++) {
+    hist[a->ids[i]]++;
+  }
+  if (a->private_counts) {
+    memcpy(a->row, hist, a->bucket_count * sizeof(size_t));
+    free(hist);
+  }
+  return NULL;
+}  /* Count */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Seconds for thread_count threads to count their blocks
+ * In arg:      ids, n (per thread), bucket_count, thread_count,
+ *              private_counts
+ */
+static double Run(const uint16_t *ids, size_t n, int bucket_count,
+    int thread_count, int private_counts) {
+  pthread_t *handles = malloc(thread_count * sizeof(pthread_t));
+  count_arg *args = malloc(thread_count * sizeof(count_arg));
+  size_t *shared = calloc((size_t) thread_count * bucket_count, sizeof(size_t));
+  pthread_barrier_t barrier;
+  double start, finish;
+  int t;
+
+  pthread_barrier_init(&barrier, NULL, thread_count + 1);
+  for (t = 0; t < thread_count; t++) {
+    args[t].ids = ids + (size_t) t * n;
+    args[t].n = n;
+    args[t].bucket_count = bucket_count;
+    args[t].row = shared + (size_t) t * bucket_count;
+    args[t].private_counts = private_counts;
+    args[t].barrier = &barrier;
+    pthread_create(&handles[t], NULL, Count, &args[t]);
+  }
+  pthread_barrier_wait(&barrier);
+  GET_TIME(start);
+  for (t = 0; t < thread_count; t++) {
+    pthread_join(handles[t], NULL);
+  }
+  GET_TIME(finish);
+
+  pthread_barrier_destroy(&barrier);
+  free(shared);
+  free(args);
+  free(handles);
+  return finish - start;
+}  /* Run */
+
+
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? strtol(argv[1], NULL, 10) : 64;
+  size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 4000000;
+  int bucket_count = argc > 3 ? strtol(argv[3], NULL, 10) : 4;
+  uint16_t *ids = malloc((size_t) max_threads * n * sizeof(uint16_t));
+  size_t i;
+  int t;
+
+  srandom(1);
+  for (i = 0; i < (size_t) max_threads * n; i++) {
+    ids[i] = (uint16_t) (random() % bucket_count);
+  }
+
+  printf("%zu keys per thread, %d buckets\n", n, bucket_count);
+  printf("threads  shared rows (s)  private (s)\n");
+  for (t = 1; t <= max_threads; t *= 2) {
+    printf("%7d  %e     %e\n", t, Run(ids, n, bucket_count, t, 0),
+        Run(ids, n, bucket_count, t, 1));
+  }
+
+  free(ids);
+  return 0;
+}  /* main */
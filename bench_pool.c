@@ -0,0 +1,100 @@
+/* File:       bench_pool.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Measure the per-call cost of sample_sort on small lists when
+ *             threads are created and joined on every call versus when the
+ *             work is dispatched onto a persistent thread pool.
+ *
+ * Compile:    gcc -O2 -Wall bench_pool.c sample_sort.c thread_pool.c -o bench_pool -lpthread
+ * Run:        bench_pool [number of threads] [calls per size]
+ *
+ * Output:     Microseconds per sample_sort call for each list size, for
+ *             both models, plus an empty pool dispatch for reference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer.h"
+#include "sample_sort.h"
+
+
+/*--------------------------------------------------------------------
+ * Function:    Noop
+ * Purpose:     Empty pool task, isolates the dispatch/wake-up latency
+ * In arg:      arg, rank
+ */
+static void Noop(void *arg, int rank) {
+  (void) arg;
+  (void) rank;
+}  /* Noop */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Time_calls
+ * Purpose:     Average seconds per sample_sort call on fresh random data
+ * In arg:      n, calls, opts
+ * Scratch:     list
+ */
+static double Time_calls(int *list, size_t n, int calls, const sort_opts *opts) {
+  double start, finish, total = 0.0;
+  size_t i;
+  int c;
+
+  srandom(1);
+  for (c = 0; c < calls; c++) {
+    for (i = 0; i < n; i++) {
+      list[i] = random() % 1000000;
+    }
+    GET_TIME(start);
+    sample_sort(list, n, opts);
+    GET_TIME(finish);
+    total += finish - start;
+  }
+  return total / calls;
+}  /* Time_calls */
+
+
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+  size_t sizes[] = {256, 1024, 4096, 16384, 65536};
+  int thread_count = argc > 1 ? strtol(argv[1], NULL, 10) : 4;
+  int calls = argc > 2 ? strtol(argv[2], NULL, 10) : 2000;
+  int *list = malloc(sizes[4] * sizeof(int));
+  sort_opts opts;
+  double start, finish, spawn, pooled;
+  unsigned s;
+  int c;
+
+  Sort_opts_init(&opts);
+  opts.thread_count = thread_count;
+  opts.sample_size = thread_count * 16;
+
+  thread_pool *pool = Pool_create(thread_count);
+  if (pool == NULL) {
+    perror("Pool_create");
+    return 1;
+  }
+
+  GET_TIME(start);
+  for (c = 0; c < calls; c++) {
+    Pool_run(pool, thread_count, Noop, NULL);
+  }
+  GET_TIME(finish);
+  printf("threads = %d, empty pool dispatch = %.2f us\n",
+      thread_count, 1e6 * (finish - start) / calls);
+
+  printf("%10s %16s %16s\n", "n", "create/join us", "pool us");
+  for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    opts.pool = NULL;
+    spawn = Time_calls(list, sizes[s], calls, &opts);
+    opts.pool = pool;
+    pooled = Time_calls(list, sizes[s], calls, &opts);
+    printf("%10zu %16.2f %16.2f\n", sizes[s], 1e6 * spawn, 1e6 * pooled);
+  }
+
+  Pool_destroy(pool);
+  free(list);
+  return 0;
+}  /* main */
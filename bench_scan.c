@@ -0,0 +1,124 @@
+/* File:       bench_scan.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Compare a serial exclusive scan with the two-pass and
+ *             look-back scans of scan.h run on a thread pool, for thread
+ *             counts doubling up to the maximum given. The default size is
+ *             that of a 256 x 256 distribution matrix.
+ *
+ * Compile:    gcc -O2 -Wall bench_scan.c thread_pool.c -o bench_scan -lpthread
+ * Run:        bench_scan [max threads] [elements] [repetitions]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer.h"
+#include "thread_pool.h"
+#include "scan.h"
+
+typedef struct {
+  blocked_scan blocked;
+  lookback_scan lookback;
+  int use_lookback;
+  const size_t *in;
+  size_t *out;
+  size_t n;
+} scan_arg;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Scan_task
+ * Purpose:     One rank's share of the chosen scan
+ * In arg:      arg (scan_arg), rank
+ */
+static void Scan_task(void *arg, int rank) {
+  scan_arg *a = arg;
+
+  if (a->use_lookback) {
+    Lookback_scan(&a->lookback, a->in, a->out, a->n);
+  } else {
+    Blocked_scan(&a->blocked, a->in, a->out, a->n, rank);
+  }
+}  /* Scan_task */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Best of reps seconds for one scan of in, with
+ *              thread_count threads (0 for the serial loop)
+ * In arg:      pool, in, n, thread_count, use_lookback, reps
+ * Scratch:     out
+ */
+static double Run(thread_pool *pool, const size_t *in, size_t *out, size_t n,
+    int thread_count, int use_lookback, int reps) {
+  double start, finish, best = 0;
+  scan_arg arg;
+  size_t i, sum;
+  int r;
+
+  arg.use_lookback = use_lookback;
+  arg.in = in;
+  arg.out = out;
+  arg.n = n;
+  for (r = 0; r < reps; r++) {
+    if (thread_count > 0 && use_lookback) {
+      Lookback_scan_init(&arg.lookback, n, SCAN_TILE);
+    } else if (thread_count > 0) {
+      Blocked_scan_init(&arg.blocked, thread_count);
+    }
+    GET_TIME(start);
+    if (thread_count == 0) {
+      sum = 0;
+      for (i = 0; i < n; i++) {
+        out[i] = sum;
+        sum += in[i];
+      }
+      out[n] = sum;
+    } else {
+      Pool_run(pool, thread_count, Scan_task, &arg);
+    }
+    GET_TIME(finish);
+    if (thread_count > 0 && use_lookback) {
+      Lookback_scan_free(&arg.lookback);
+    } else if (thread_count > 0) {
+      Blocked_scan_free(&arg.blocked);
+    }
+    if (r == 0 || finish - start < best) {
+      best = finish - start;
+    }
+  }
+  return best;
+}  /* Run */
+
+
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? strtol(argv[1], NULL, 10) : 64;
+  size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 256 * 256;
+  int reps = argc > 3 ? strtol(argv[3], NULL, 10) : 100;
+  size_t *in = malloc(n * sizeof(size_t));
+  size_t *out = malloc((n + 1) * sizeof(size_t));
+  thread_pool *pool = Pool_create(max_threads);
+  size_t i;
+  int t;
+
+  srandom(1);
+  for (i = 0; i < n; i++) {
+    in[i] = random() % 1000;
+  }
+
+  printf("%zu elements, best of %d, seconds per scan\n", n, reps);
+  printf("serial   %e\n", Run(pool, in, out, n, 0, 0, reps));
+  printf("threads  two-pass      look-back\n");
+  for (t = 1; t <= max_threads; t *= 2) {
+    printf("%7d  %e  %e\n", t, Run(pool, in, out, n, t, 0, reps),
+        Run(pool, in, out, n, t, 1, reps));
+  }
+
+  Pool_destroy(pool);
+  free(out);
+  free(in);
+  return 0;
+}  /* main */
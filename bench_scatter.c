@@ -0,0 +1,71 @@
+/* File:       bench_scatter.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Compare plain stores with write-combining buffers and
+ *             streaming stores for the classify-and-scatter pass, on a
+ *             list meant to be much larger than the last level cache
+ *             and with many buckets.
+ *
+ * Compile:    gcc -O2 -Wall bench_scatter.c sample_sort.c thread_pool.c -o bench_scatter -lpthread
+ * Run:        bench_scatter [number of threads] [list size] [buckets] [repetitions]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer.h"
+#include "sample_sort.h"
+
+
+/*--------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Best of reps sorts of fresh random lists
+ * In arg:      name, n, reps, opts
+ * Scratch:     list
+ */
+static void Run(const char *name, int *list, size_t n, int reps, sort_opts *opts) {
+  double start, finish, best = 0;
+  size_t i;
+  int r;
+
+  for (r = 0; r < reps; r++) {
+    srandom(r + 1);
+    for (i = 0; i < n; i++) {
+      list[i] = random();
+    }
+    GET_TIME(start);
+    sample_sort(list, n, opts);
+    GET_TIME(finish);
+    if (r == 0 || finish - start < best) {
+      best = finish - start;
+    }
+  }
+  printf("%-28s %e seconds\n", name, best);
+}  /* Run */
+
+
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+  int thread_count = argc > 1 ? strtol(argv[1], NULL, 10) : 4;
+  size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 1 << 27;
+  int bucket_count = argc > 3 ? strtol(argv[3], NULL, 10) : 1024;
+  int reps = argc > 4 ? strtol(argv[4], NULL, 10) : 3;
+  int *list = malloc(n * sizeof(int));
+  sort_opts opts;
+
+  Sort_opts_init(&opts);
+  opts.thread_count = thread_count;
+  opts.bucket_count = bucket_count;
+  opts.sample_size = bucket_count * 16;
+  opts.partition = PARTITION_CLASSIFY;
+  opts.bucket_kernel = SORT_RADIX;
+
+  printf("%zu keys, %d threads, %d buckets\n", n, thread_count, bucket_count);
+  opts.scatter = SCATTER_PLAIN;
+  Run("plain stores", list, n, reps, &opts);
+  opts.scatter = SCATTER_STREAM;
+  Run("write-combined streaming", list, n, reps, &opts);
+
+  free(list);
+  return 0;
+}  /* main */
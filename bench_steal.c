@@ -0,0 +1,68 @@
+/* File:       bench_steal.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Compare the shared bucket queue with work stealing on a
+ *             duplicate-heavy list, where one bucket holds a large share
+ *             of the keys, and print every thread's busy and idle time
+ *             during the bucket phase.
+ *
+ * Compile:    gcc -O2 -Wall bench_steal.c sample_sort.c thread_pool.c -o bench_steal -lpthread
+ * Run:        bench_steal [number of threads] [list size] [heavy key share (0-100)]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer.h"
+#include "sample_sort.h"
+
+
+/*--------------------------------------------------------------------
+ * Function:    Run
+ * Purpose:     Sort a fresh copy of the skewed list and print the report
+ * In arg:      name, n, share, opts
+ * Scratch:     list
+ */
+static void Run(const char *name, int *list, size_t n, int share, sort_opts *opts) {
+  double start, finish;
+  size_t i;
+  int t;
+
+  srandom(1);
+  for (i = 0; i < n; i++) {
+    list[i] = (random() % 100 < share) ? 42 : random();
+  }
+  GET_TIME(start);
+  sample_sort(list, n, opts);
+  GET_TIME(finish);
+
+  printf("\n======= %s: %e seconds =======\n", name, finish - start);
+  for (t = 0; t < opts->thread_count; t++) {
+    printf("thread %2d  busy = %e  idle = %e\n", t,
+        opts->stats[t].busy, opts->stats[t].idle);
+  }
+}  /* Run */
+
+
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+  int thread_count = argc > 1 ? strtol(argv[1], NULL, 10) : 4;
+  size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 4000000;
+  int share = argc > 3 ? strtol(argv[3], NULL, 10) : 40;
+  int *list = malloc(n * sizeof(int));
+  sort_opts opts;
+
+  Sort_opts_init(&opts);
+  opts.thread_count = thread_count;
+  opts.sample_size = thread_count * 64;
+  opts.stats = malloc(thread_count * sizeof(thread_stats));
+
+  opts.schedule = SCHEDULE_QUEUE;
+  Run("shared bucket queue", list, n, share, &opts);
+  opts.schedule = SCHEDULE_STEAL;
+  Run("work stealing", list, n, share, &opts);
+
+  free(opts.stats);
+  free(list);
+  return 0;
+}  /* main */
@@ -0,0 +1,434 @@
+/* File:       check_sort.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Correctness check to run next to the benchmarks. Every
+ *             combination of sort options (partition, sampling, scatter,
+ *             chunk and bucket kernels, schedule, nested sorts, pool or
+ *             spawned threads) sorts a set of key distributions and
+ *             sizes, and each result is compared with qsort. Then the
+ *             loaders of input.h read generated text and binary files
+ *             and are compared with a fscanf("%d") loop and the keys
+ *             written.
+ *
+ * Compile:    gcc -O2 -Wall check_sort.c sample_sort.c thread_pool.c input.c -o check_sort -lpthread
+ * Run:        check_sort [max threads] [largest list size]
+ *
+ * Output:     One line per failure and a summary; the exit status is 1 if
+ *             anything failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "sample_sort.h"
+#include "input.h"
+
+#define DISTRIBUTIONS 7
+#define TEXT_FILES 200
+
+static const char *dist_names[DISTRIBUTIONS] = {
+  "random", "equal", "sorted", "reversed", "few distinct", "extremes",
+  "one heavy key"
+};
+
+// Separators the text parser must treat like fscanf does
+static const char *spaces[] = { " ", "\n", "\t", "  ", "\r\n", " \v\f " };
+
+// Tokens that are not one plain int: fscanf splits some at a sign and
+// stops in the others, keeping any leading digits
+static const char *odd_tokens[] = {
+  "12abc", "12-5", "1-2-3", "7+8", "5--3", "4+", "+", "-", "--1", "+-2",
+  "0x10", "9.5", "3,4", "abc", "8a-3", "00012-0007"
+};
+
+
+/*--------------------------------------------------------------------
+ * Function:    Compare
+ * Purpose:     qsort comparison of two ints
+ * In arg:      a, b
+ */
+static int Compare(const void *a, const void *b) {
+  int x = *(const int *) a, y = *(const int *) b;
+
+  return (x > y) - (x < y);
+}  /* Compare */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Fill
+ * Purpose:     Generate n keys of one distribution
+ * In arg:      n, dist
+ * Out arg:     list
+ */
+static void Fill(int *list, size_t n, int dist) {
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    switch (dist) {
+      case 0:  list[i] = (int) (random() % 2000001) - 1000000; break;
+      case 1:  list[i] = 7; break;
+      case 2:  list[i] = (int) i; break;
+      case 3:  list[i] = (int) (n - i); break;
+      case 4:  list[i] = (int) (random() % 4); break;
+      case 5:  list[i] = random() % 3 == 0 ? INT_MIN :
+                   random() % 2 ? INT_MAX : (int) (random() - RAND_MAX / 2);
+               break;
+      default: list[i] = random() % 2 ? 42 : (int) random(); break;
+    }
+  }
+}  /* Fill */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Set_options
+ * Purpose:     Decode option combination number c into opts, or report
+ *              that it only repeats an earlier combination
+ * In arg:      c, thread_count, pool
+ * Out arg:     opts
+ * Return val:  1 if the combination is worth running, 0 if not
+ */
+static int Set_options(sort_opts *opts, int c, int thread_count,
+    thread_pool *pool) {
+  Sort_opts_init(opts);
+  opts->thread_count = thread_count;
+  opts->partition = (partition_mode) (c % 4);
+  c /= 4;
+  opts->sampling = c % 2 ? SAMPLE_REGULAR : SAMPLE_RANDOM;
+  c /= 2;
+  opts->scatter = c % 2 ? SCATTER_STREAM : SCATTER_PLAIN;
+  c /= 2;
+  opts->local_kernel = (sort_kernel) (c % 4);
+  c /= 4;
+  opts->bucket_kernel = (sort_kernel) (c % 4);
+  c /= 4;
+  opts->schedule = c % 2 ? SCHEDULE_STEAL : SCHEDULE_QUEUE;
+  c /= 2;
+  // Small thresholds force nested sorts, a few buckets per thread skew
+  if (c % 2) {
+    opts->nested_threshold = 64;
+    opts->bucket_count = 3 * thread_count;
+  }
+  c /= 2;
+  opts->pool = c % 2 ? pool : NULL;
+
+  // Options a partition ignores would only repeat the same sort
+  if (opts->scatter == SCATTER_STREAM && (opts->partition != PARTITION_CLASSIFY ||
+      opts->sampling == SAMPLE_REGULAR)) {
+    return 0;
+  }
+  if (opts->sampling == SAMPLE_REGULAR && (opts->partition == PARTITION_EXACT ||
+      opts->partition == PARTITION_INPLACE)) {
+    return 0;
+  }
+  if (opts->local_kernel != SORT_INTRO && (opts->partition == PARTITION_INPLACE ||
+      (opts->partition == PARTITION_CLASSIFY && opts->sampling == SAMPLE_RANDOM))) {
+    return 0;
+  }
+  return 1;
+}  /* Set_options */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Check_sorts
+ * Purpose:     Sort every distribution and size with every option
+ *              combination and thread count, comparing with qsort
+ * In arg:      pool, max_threads, max_n
+ * Out arg:     runs (sorts done)
+ * Return val:  Number of failed sorts
+ */
+static int Check_sorts(thread_pool *pool, int max_threads, size_t max_n,
+    int *runs) {
+  size_t sizes[] = { 0, 1, 2, 17, 1000, 4097, max_n };
+  int threads[] = { 1, 3, max_threads };
+  int size_count = sizeof(sizes) / sizeof(sizes[0]);
+  int *list = malloc((max_n > 0 ? max_n : 1) * sizeof(int));
+  int *expected = malloc((max_n > 0 ? max_n : 1) * sizeof(int));
+  int s, d, c, i, t, failed = 0;
+  sort_opts opts;
+  size_t n;
+
+  for (s = 0; s < size_count; s++) {
+    n = sizes[s];
+    if (n > max_n) {
+      continue;
+    }
+    for (d = 0; d < DISTRIBUTIONS; d++) {
+      for (i = 0; i < 3; i++) {
+        t = threads[i];
+        if (t > max_threads || (i == 2 && t <= threads[1])) {
+          continue;
+        }
+        for (c = 0; c < 4 * 2 * 2 * 4 * 4 * 2 * 2 * 2; c++) {
+          if (!Set_options(&opts, c, t, pool)) {
+            continue;
+          }
+          srandom(s * 7919 + d * 31 + t);
+          Fill(list, n, d);
+          memcpy(expected, list, n * sizeof(int));
+          qsort(expected, n, sizeof(int), Compare);
+          (*runs)++;
+          if (sample_sort(list, n, &opts) != 0) {
+            printf("FAIL sort %zu %s keys, %d threads, options %d: %s\n",
+                n, dist_names[d], t, c, strerror(errno));
+            failed++;
+          } else if (n > 0 && memcmp(list, expected, n * sizeof(int)) != 0) {
+            printf("FAIL sort %zu %s keys, %d threads, options %d: wrong order\n",
+                n, dist_names[d], t, c);
+            failed++;
+          }
+        }
+      }
+    }
+  }
+  free(list);
+  free(expected);
+  return failed;
+}  /* Check_sorts */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Write_token
+ * Purpose:     Write one random token to a text file: mostly ints of
+ *              every shape fscanf accepts, some pairs joined by a sign,
+ *              now and then one it stops in. Every number is in the int
+ *              range, where fscanf("%d") is defined
+ * In arg:      f
+ */
+static void Write_token(FILE *f) {
+  int odd_count = sizeof(odd_tokens) / sizeof(odd_tokens[0]);
+
+  switch (random() % 40) {
+    case 0:  fprintf(f, "%d", INT_MIN); break;
+    case 1:  fprintf(f, "%d", INT_MAX); break;
+    case 2:  fprintf(f, "+%ld", random()); break;
+    case 3:  fprintf(f, "000000000000%ld", random() % 1000); break;
+    case 4:  fprintf(f, "%s", random() % 20 ? "-0" : odd_tokens[random() % odd_count]);
+             break;
+    case 5:  fprintf(f, "%ld-%ld", random() % 1000, random() % 1000); break;
+    case 6:  fprintf(f, "-%ld", random() % 100); break;
+    default: fprintf(f, "%ld", random() - RAND_MAX / 2); break;
+  }
+  fputs(spaces[random() % (sizeof(spaces) / sizeof(spaces[0]))], f);
+}  /* Write_token */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Reference_parse
+ * Purpose:     Read up to max_n keys with the fscanf("%d") loop that
+ *              input.h promises to match
+ * In arg:      path, max_n
+ * Out arg:     keys (room for three keys per token of the file)
+ * Return val:  Number of keys read
+ */
+static size_t Reference_parse(const char *path, size_t max_n, int *keys) {
+  FILE *f = fopen(path, "r");
+  size_t n = 0;
+  int key;
+
+  while (n < max_n && fscanf(f, "%d", &key) == 1) {
+    keys[n++] = key;
+  }
+  fclose(f);
+  return n;
+}  /* Reference_parse */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Check_text
+ * Purpose:     Parse generated text files with and without the pool and
+ *              compare with Reference_parse, then check that a number
+ *              outside the int range stops the parse
+ * In arg:      pool, path
+ * Out arg:     runs (files parsed)
+ * Return val:  Number of failed parses
+ */
+static int Check_text(thread_pool *pool, const char *path, int *runs) {
+  int i, k, count, failed = 0;
+  size_t max_n, expected_n;
+  int *expected;
+  input_list in;
+  FILE *f;
+
+  for (i = 0; i < TEXT_FILES; i++) {
+    srandom(i);
+    count = random() % (i % 10 == 0 ? 20000 : 60);
+    f = fopen(path, "w");
+    if (random() % 3 == 0) {
+      fputs(" \n", f);
+    }
+    for (k = 0; k < count; k++) {
+      Write_token(f);
+    }
+    fclose(f);
+    max_n = random() % 4 ? SIZE_MAX : (size_t) (random() % 50);
+
+    expected = malloc((3 * (size_t) count + 1) * sizeof(int));
+    expected_n = Reference_parse(path, max_n, expected);
+    (*runs)++;
+    if (Input_parse_text(&in, path, max_n, i % 2 ? pool : NULL) != 0) {
+      printf("FAIL text file %d: %s\n", i, strerror(errno));
+      failed++;
+    } else {
+      if (in.n != expected_n ||
+          memcmp(in.list, expected, expected_n * sizeof(int)) != 0) {
+        printf("FAIL text file %d: %zu keys, expected %zu\n", i, in.n, expected_n);
+        failed++;
+      }
+      Input_free(&in);
+    }
+    free(expected);
+  }
+
+  // Out of range, fscanf is undefined and the parser stops before it
+  f = fopen(path, "w");
+  fputs("1 -2 2147483648 3\n", f);
+  fclose(f);
+  (*runs)++;
+  if (Input_parse_text(&in, path, SIZE_MAX, pool) != 0) {
+    printf("FAIL text out of range: %s\n", strerror(errno));
+    failed++;
+  } else {
+    if (in.n != 2 || in.list[0] != 1 || in.list[1] != -2) {
+      printf("FAIL text out of range: %zu keys, expected 2\n", in.n);
+      failed++;
+    }
+    Input_free(&in);
+  }
+  return failed;
+}  /* Check_text */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Write_binary
+ * Purpose:     Write keys to a binary file with the given key width
+ * In arg:      path, keys, n, width (4 or 8)
+ */
+static void Write_binary(const char *path, const int *keys, size_t n, int width) {
+  FILE *f = fopen(path, "wb");
+  unsigned char word[8];
+  uint64_t x;
+  size_t i;
+  int b;
+
+  fwrite("PSSB", 1, 4, f);
+  for (b = 0; b < 4; b++) {
+    word[b] = (unsigned char) (width >> (8 * b));
+  }
+  fwrite(word, 1, 4, f);
+  for (b = 0; b < 8; b++) {
+    word[b] = (unsigned char) ((uint64_t) n >> (8 * b));
+  }
+  fwrite(word, 1, 8, f);
+  for (i = 0; i < n; i++) {
+    x = (uint64_t) (int64_t) keys[i];
+    for (b = 0; b < width; b++) {
+      word[b] = (unsigned char) (x >> (8 * b));
+    }
+    fwrite(word, 1, width, f);
+  }
+  fclose(f);
+}  /* Write_binary */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Check_binary
+ * Purpose:     Load generated binary files of both widths, sort the
+ *              loaded list as main does, and load the file again to see
+ *              that sorting the mapping left it unchanged
+ * In arg:      pool, path, n
+ * Out arg:     runs (files loaded)
+ * Return val:  Number of failed loads
+ */
+static int Check_binary(thread_pool *pool, const char *path, size_t n, int *runs) {
+  int *keys = malloc((n > 0 ? n : 1) * sizeof(int));
+  int *sorted = malloc((n > 0 ? n : 1) * sizeof(int));
+  int width, failed = 0;
+  input_list in;
+  sort_opts opts;
+
+  srandom(1);
+  Fill(keys, n, 5);
+  memcpy(sorted, keys, n * sizeof(int));
+  qsort(sorted, n, sizeof(int), Compare);
+  Sort_opts_init(&opts);
+  opts.pool = pool;
+  opts.thread_count = Pool_size(pool);
+
+  for (width = 4; width <= 8; width += 4) {
+    Write_binary(path, keys, n, width);
+    (*runs)++;
+    if (Input_map_binary(&in, path, SIZE_MAX, pool) != 0) {
+      printf("FAIL binary width %d: %s\n", width, strerror(errno));
+      failed++;
+      continue;
+    }
+    if (in.n != n || memcmp(in.list, keys, n * sizeof(int)) != 0) {
+      printf("FAIL binary width %d: keys differ\n", width);
+      failed++;
+    } else if (sample_sort(in.list, in.n, &opts) != 0 ||
+        memcmp(in.list, sorted, n * sizeof(int)) != 0) {
+      printf("FAIL binary width %d: loaded list not sorted\n", width);
+      failed++;
+    }
+    Input_free(&in);
+
+    if (Input_map_binary(&in, path, SIZE_MAX, NULL) != 0 ||
+        in.n != n || memcmp(in.list, keys, n * sizeof(int)) != 0) {
+      printf("FAIL binary width %d: file changed by the sort\n", width);
+      failed++;
+    }
+    Input_free(&in);
+  }
+  free(keys);
+  free(sorted);
+  return failed;
+}  /* Check_binary */
+
+
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? strtol(argv[1], NULL, 10) : 4;
+  size_t max_n = argc > 2 ? strtoul(argv[2], NULL, 10) : 20000;
+  thread_pool *pool = Pool_create(max_threads);
+  char path[] = "/tmp/check_sort_XXXXXX";
+  int fd, runs, failed, input_failed;
+
+  if (pool == NULL) {
+    perror("Pool_create");
+    return 1;
+  }
+  runs = 0;
+  failed = Check_sorts(pool, max_threads, max_n, &runs);
+  printf("sorts:  %d of %d match qsort\n", runs - failed, runs);
+
+  fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    Pool_destroy(pool);
+    return 1;
+  }
+  close(fd);
+  runs = 0;
+  input_failed = Check_text(pool, path, &runs);
+  input_failed += Check_binary(pool, path, max_n, &runs);
+  printf("inputs: %d of %d loads match the reference\n", runs - input_failed, runs);
+  unlink(path);
+  failed += input_failed;
+
+  Pool_destroy(pool);
+  printf("%s\n", failed == 0 ? "all checks passed" : "CHECKS FAILED");
+  return failed != 0;
+}  /* main */
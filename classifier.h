@@ -0,0 +1,145 @@
+/* File:       classifier.h
+ *
+ * Purpose:    Branch-free bucket classification of unsorted int keys
+ *             against a sorted set of splitters (the super-scalar sample
+ *             sort classifier of Sanders and Winkel).
+ *
+ * Note:       With splitters s[0..k-2], bucket b receives the keys with
+ *             s[b-1] <= key < s[b] (open ended at both ends), the same
+ *             rule the splitter walk in sample_sort.c uses. k may be any
+ *             count from 1 to MAX_BUCKETS.
+ *
+ * Example:
+ *    classifier c;
+ *    int *tree = malloc(Classifier_size(bucket_count) * sizeof(int));
+ *    Classifier_lay_out(&c, tree, splitters, bucket_count);
+ *    Classify_batch(&c, keys, n, bucket_of);
+ *    . . .
+ *    free(tree);
+ *
+ * Algorithm:  The splitters, padded with copies of the largest one to
+ *             2^log_buckets - 1 entries, are stored as an implicit binary
+ *             search tree: node j has children 2j and 2j+1 and tree[1] is
+ *             the root. Descending is j = 2j + (key >= tree[j]), so the
+ *             comparison result feeds an add instead of a branch, and
+ *             Classify_batch walks CLASSIFY_UNROLL keys down the tree
+ *             together so their loads overlap. Keys beyond the largest
+ *             real splitter reach the padded leaves and are folded back
+ *             into the last bucket.
+ */
+#ifndef _CLASSIFIER_H_
+#define _CLASSIFIER_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MAX_BUCKETS 65536
+#define CLASSIFY_UNROLL 8
+
+typedef uint16_t bucket_id;
+
+typedef struct {
+  int *tree;              // tree[1 .. (1 << log_buckets) - 1]
+  int log_buckets;
+  int bucket_count;       // Real buckets, at most 1 << log_buckets
+} classifier;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Classifier_size
+ * Purpose:     Number of ints the search tree for bucket_count takes
+ * In arg:      bucket_count
+ */
+static size_t Classifier_size(int bucket_count) {
+  size_t size = 1;
+
+  while (size < (size_t) bucket_count) {
+    size *= 2;
+  }
+  return size;
+}  /* Classifier_size */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Classifier_lay_out
+ * Purpose:     Lay out bucket_count - 1 sorted splitters as a search tree
+ *              in tree, which the classifier uses but does not own
+ * In arg:      tree (Classifier_size(bucket_count) ints), splitters,
+ *              bucket_count
+ * Out arg:     c
+ */
+static void Classifier_lay_out(classifier *c, int *tree, const int *splitters,
+    int bucket_count) {
+  int level, j, rank;
+
+  c->log_buckets = 0;
+  while ((1 << c->log_buckets) < bucket_count) {
+    c->log_buckets++;
+  }
+  c->bucket_count = bucket_count;
+  c->tree = tree;
+
+  // Node j on level l is the m-th of its level (m = j - 2^l) and holds
+  // the splitter of in-order rank (2m + 1) * 2^(log - 1 - l) - 1
+  for (level = 0; level < c->log_buckets; level++) {
+    for (j = 1 << level; j < (2 << level); j++) {
+      rank = ((2 * (j - (1 << level)) + 1) << (c->log_buckets - 1 - level)) - 1;
+      c->tree[j] = splitters[rank < bucket_count - 1 ? rank : bucket_count - 2];
+    }
+  }
+}  /* Classifier_lay_out */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Classify
+ * Purpose:     Bucket of a single key
+ * In arg:      c, key
+ */
+static inline int Classify(const classifier *c, int key) {
+  size_t j = 1;
+  int level, b;
+
+  for (level = 0; level < c->log_buckets; level++) {
+    j = 2 * j + (key >= c->tree[j]);
+  }
+  b = (int) j - (1 << c->log_buckets);
+  return b < c->bucket_count ? b : c->bucket_count - 1;
+}  /* Classify */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Classify_batch
+ * Purpose:     Bucket of every key, CLASSIFY_UNROLL keys at a time
+ * In arg:      c, keys, n
+ * Out arg:     bucket_of
+ */
+static void Classify_batch(const classifier *c, const int *keys, size_t n,
+    bucket_id *bucket_of) {
+  const int *tree = c->tree;
+  int log_buckets = c->log_buckets, last = c->bucket_count - 1;
+  size_t i, j[CLASSIFY_UNROLL];
+  int level, u, b;
+
+  for (i = 0; i + CLASSIFY_UNROLL <= n; i += CLASSIFY_UNROLL) {
+    for (u = 0; u < CLASSIFY_UNROLL; u++) {
+      j[u] = 1;
+    }
+    for (level = 0; level < log_buckets; level++) {
+      for (u = 0; u < CLASSIFY_UNROLL; u++) {
+        j[u] = 2 * j[u] + (keys[i + u] >= tree[j[u]]);
+      }
+    }
+    for (u = 0; u < CLASSIFY_UNROLL; u++) {
+      b = (int) j[u] - (1 << log_buckets);
+      bucket_of[i + u] = (bucket_id) (b < last ? b : last);
+    }
+  }
+  for (; i < n; i++) {
+    bucket_of[i] = (bucket_id) Classify(c, keys[i]);
+  }
+}  /* Classify_batch */
+
+#endif
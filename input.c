@@ -0,0 +1,661 @@
+/* File:       input.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    File loaders declared in input.h.
+ *
+ * Compile:    gcc -g -Wall -c input.c
+ *
+ * Algorithm:  The whole file is mapped private and read-only with
+ *             MAP_POPULATE (or an madvise hint where that flag is
+ *             missing), so the kernel reads it in with large sequential
+ *             requests before the first key is touched and the mapping
+ *             shares the page cache's pages. Only then is it made
+ *             writable: populating a writable private mapping would copy
+ *             every page up front. Keys the sort can use as they are
+ *             stay in the mapping, and the first write to a page copies
+ *             just that page. Other keys are decoded from the mapping by
+ *             every rank of the pool into the chunk Chunk_start of
+ *             sample_sort.c will give the same rank, so a chunk's pages
+ *             are first touched by the thread that sorts them.
+ *
+ *             Text is parsed from a mapping that stays read-only, in two
+ *             passes over one byte range per rank: the first counts the
+ *             keys of every range, which places each rank's keys in the
+ *             list, and the second parses them there. A number starts
+ *             at every token and at every sign right after a digit; a
+ *             rank that meets input a fscanf loop would stop at says so,
+ *             and the keys of later ranks are dropped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "input.h"
+
+#define BINARY_MAGIC "PSSB"
+#define BINARY_HEADER 16
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define HOST_LITTLE_ENDIAN 1
+#else
+#define HOST_LITTLE_ENDIAN 0
+#endif
+
+// One conversion of mapped keys into a list, shared by the ranks
+typedef struct {
+  const unsigned char *src;
+  int *dest;
+  size_t n;
+  int width;
+  int thread_count;
+  atomic_int out_of_range;
+} convert_arg;
+
+// One parse of a mapped text file, shared by the ranks; pass 0 counts
+// the keys of every rank's byte range, pass 1 parses them
+typedef struct {
+  const unsigned char *text;
+  size_t size;
+  int thread_count;
+  int pass;
+  size_t *counts;        // Keys in each rank's range
+  size_t *offsets;       // First list index of each rank's keys
+  size_t *parsed;        // Keys each rank stored before a bad token
+  int *stopped;          // Rank met input a fscanf loop would stop at
+  int *dest;
+  size_t max_n;
+} parse_arg;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Load_le32
+ * Purpose:     Read a little-endian 32-bit word (a plain load on a
+ *              little-endian host once optimized)
+ * In arg:      p
+ */
+static uint32_t Load_le32(const unsigned char *p) {
+  return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 |
+      (uint32_t) p[3] << 24;
+}  /* Load_le32 */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Load_le64
+ * Purpose:     Read a little-endian 64-bit word
+ * In arg:      p
+ */
+static uint64_t Load_le64(const unsigned char *p) {
+  return (uint64_t) Load_le32(p) | (uint64_t) Load_le32(p + 4) << 32;
+}  /* Load_le64 */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Convert
+ * Purpose:     Decode one rank's chunk of the mapped keys into the list,
+ *              narrowing 8-byte keys
+ * In arg:      arg (convert_arg), rank
+ */
+static void Convert(void *arg, int rank) {
+  convert_arg *a = arg;
+  size_t first = (size_t) rank * a->n / a->thread_count;
+  size_t last = (size_t) (rank + 1) * a->n / a->thread_count;
+  const unsigned char *p = a->src + first * a->width;
+  int64_t key;
+  size_t i;
+
+  if (a->width == 4) {
+    for (i = first; i < last; i++, p += 4) {
+      a->dest[i] = (int32_t) Load_le32(p);
+    }
+    return;
+  }
+  for (i = first; i < last; i++, p += 8) {
+    key = (int64_t) Load_le64(p);
+    if (key < INT_MIN || key > INT_MAX) {
+      atomic_store(&a->out_of_range, 1);
+      return;
+    }
+    a->dest[i] = (int) key;
+  }
+}  /* Convert */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Map_file
+ * Purpose:     Map a whole file private, asking the kernel to read it
+ *              all in up front without copying it
+ * In arg:      path, writable (0 leaves the mapping read-only)
+ * Out arg:     size
+ * Return val:  The mapping, or NULL with errno set
+ */
+static void *Map_file(const char *path, int writable, size_t *size) {
+  struct stat st;
+  void *map;
+  int fd, flags = MAP_PRIVATE;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return NULL;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    errno = EINVAL;
+    return NULL;
+  }
+#if defined(MAP_POPULATE)
+  flags |= MAP_POPULATE;
+#endif
+  // Populated read-only, the mapping takes the page cache's pages as
+  // they are; each becomes a private copy only when it is written
+  map = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+#if !defined(MAP_POPULATE)
+  madvise(map, st.st_size, MADV_WILLNEED);
+#endif
+  if (writable && mprotect(map, st.st_size, PROT_READ | PROT_WRITE) != 0) {
+    munmap(map, st.st_size);
+    return NULL;
+  }
+  *size = st.st_size;
+  return map;
+}  /* Map_file */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Input_is_binary
+ * Purpose:     Whether a file starts with the binary header's magic
+ * In arg:      path
+ */
+int Input_is_binary(const char *path) {
+  char magic[4];
+  int fd = open(path, O_RDONLY), binary;
+
+  if (fd < 0) {
+    return 0;
+  }
+  binary = read(fd, magic, 4) == 4 && memcmp(magic, BINARY_MAGIC, 4) == 0;
+  close(fd);
+  return binary;
+}  /* Input_is_binary */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Input_map_binary
+ * Purpose:     Load up to max_n keys of a binary file
+ * In arg:      path, max_n, pool
+ * Out arg:     in
+ * Return val:  0 on success, -1 with errno set on failure
+ */
+int Input_map_binary(input_list *in, const char *path, size_t max_n,
+    thread_pool *pool) {
+  const unsigned char *header;
+  convert_arg arg;
+  uint64_t count;
+  int width;
+
+  memset(in, 0, sizeof(*in));
+  in->map = Map_file(path, 1, &in->map_size);
+  if (in->map == NULL) {
+    return -1;
+  }
+  header = in->map;
+  width = in->map_size < BINARY_HEADER ? 0 : (int) Load_le32(header + 4);
+  count = in->map_size < BINARY_HEADER ? 0 : Load_le64(header + 8);
+  if (in->map_size < BINARY_HEADER || memcmp(header, BINARY_MAGIC, 4) != 0 ||
+      (width != 4 && width != 8) ||
+      count > (in->map_size - BINARY_HEADER) / width) {
+    Input_free(in);
+    errno = EINVAL;
+    return -1;
+  }
+  in->n = count < max_n ? count : max_n;
+
+  // The header keeps the keys 16-byte aligned in the page-aligned mapping
+  if (width == 4 && HOST_LITTLE_ENDIAN) {
+    in->list = (int *) (header + BINARY_HEADER);
+    return 0;
+  }
+
+  in->owned = malloc((in->n > 0 ? in->n : 1) * sizeof(int));
+  if (in->owned == NULL) {
+    Input_free(in);
+    errno = ENOMEM;
+    return -1;
+  }
+  arg.src = header + BINARY_HEADER;
+  arg.dest = in->owned;
+  arg.n = in->n;
+  arg.width = width;
+  arg.thread_count = pool != NULL ? Pool_size(pool) : 1;
+  atomic_init(&arg.out_of_range, 0);
+  if (pool != NULL) {
+    Pool_run(pool, arg.thread_count, Convert, &arg);
+  } else {
+    Convert(&arg, 0);
+  }
+  if (atomic_load(&arg.out_of_range)) {
+    Input_free(in);
+    errno = ERANGE;
+    return -1;
+  }
+
+  // Only the copy is needed from here on
+  munmap(in->map, in->map_size);
+  in->map = NULL;
+  in->list = in->owned;
+  return 0;
+}  /* Input_map_binary */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Is_space
+ * Purpose:     Whether a byte is white space to fscanf in the C locale
+ * In arg:      c
+ */
+static int Is_space(unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}  /* Is_space */
+
+
+
+#if defined(__AVX2__)
+/*--------------------------------------------------------------------
+ * Function:    Space_mask
+ * Purpose:     Bit i set when p[i] is white space, for 32 bytes
+ * In arg:      p
+ */
+static uint32_t Space_mask(const unsigned char *p) {
+  __m256i c = _mm256_loadu_si256((const __m256i *) p);
+  __m256i ctrl = _mm256_sub_epi8(c, _mm256_set1_epi8('\t'));
+
+  // '\t'..'\r' are the bytes whose distance from '\t' is at most 4
+  ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, _mm256_set1_epi8(4)), ctrl);
+  return (uint32_t) _mm256_movemask_epi8(
+      _mm256_or_si256(ctrl, _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' '))));
+}  /* Space_mask */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Number_starts
+ * Purpose:     Bit i set when p[i] is a sign right after a digit, where
+ *              fscanf("%d") starts a new number inside a token, for 32
+ *              bytes
+ * In arg:      p
+ * In/out arg:  digit_carry (whether the byte before p is a digit)
+ */
+static uint32_t Number_starts(const unsigned char *p, uint32_t *digit_carry) {
+  __m256i c = _mm256_loadu_si256((const __m256i *) p);
+  __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+  uint32_t digit = (uint32_t) _mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d));
+  uint32_t sign = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(
+      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-')),
+      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('+'))));
+  uint32_t starts = sign & (digit << 1 | *digit_carry);
+
+  *digit_carry = digit >> 31;
+  return starts;
+}  /* Number_starts */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Digit_count
+ * Purpose:     Length of the run of decimal digits at p, up to 16
+ * In arg:      p (16 bytes readable)
+ */
+static int Digit_count(const unsigned char *p) {
+  __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) p), _mm_set1_epi8('0'));
+  __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+  uint32_t mask = (uint32_t) _mm_movemask_epi8(digit);
+
+  return __builtin_ctz(~mask);
+}  /* Digit_count */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Digits_value
+ * Purpose:     Value of the count digits at p (1 <= count <= 16)
+ * In arg:      p (16 bytes readable), count
+ * Note:        The digits are shifted to the end of the register, zeros
+ *              coming in front, then combined pairwise by multiply-adds:
+ *              10*a+b per 2 digits, 100*a+b per 4, 10000*a+b per 8.
+ */
+static uint64_t Digits_value(const unsigned char *p, int count) {
+  __m128i v = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) p), _mm_set1_epi8('0'));
+  __m128i shift = _mm_add_epi8(
+      _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm_set1_epi8((char) (count - 16)));
+
+  // Negative indices have the top bit set, which shuffles in a zero
+  v = _mm_shuffle_epi8(v, shift);
+  v = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+      10, 1, 10, 1, 10, 1, 10, 1));
+  v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+  v = _mm_packus_epi32(v, v);
+  v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+  return (uint64_t) (uint32_t) _mm_cvtsi128_si32(v) * 100000000 +
+      (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(v, 4));
+}  /* Digits_value */
+#endif
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Range_start
+ * Purpose:     First byte of a rank's range: its even share of the file,
+ *              moved on to the next white space so no key is cut
+ * In arg:      a, rank
+ */
+static size_t Range_start(const parse_arg *a, int rank) {
+  size_t i;
+
+  if (rank == 0) {
+    return 0;
+  }
+  i = (size_t) rank * a->size / a->thread_count;
+  while (i < a->size && !Is_space(a->text[i])) {
+    i++;
+  }
+  return i;
+}  /* Range_start */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Is_digit
+ * Purpose:     Whether a byte is a decimal digit
+ * In arg:      c
+ */
+static int Is_digit(unsigned char c) {
+  return c >= '0' && c <= '9';
+}  /* Is_digit */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Count_keys
+ * Purpose:     Number of places in text[begin, end) where fscanf("%d")
+ *              would start a number: every token, plus every sign right
+ *              after a digit ("12-5" reads as 12 and -5); begin is the
+ *              start of the file or white space
+ * In arg:      text, begin, end
+ */
+static size_t Count_keys(const unsigned char *text, size_t begin, size_t end) {
+  size_t count = 0, i = begin;
+  int in_token = 0;
+
+#if defined(__AVX2__)
+  uint32_t token, carry = 0, digit_carry = 0;
+
+  // A token starts at every non-space byte after a space byte
+  for (; i + 32 <= end; i += 32) {
+    token = ~Space_mask(text + i);
+    count += __builtin_popcount(token & ~(token << 1 | carry));
+    count += __builtin_popcount(Number_starts(text + i, &digit_carry));
+    carry = token >> 31;
+  }
+  in_token = carry;
+#endif
+  for (; i < end; i++) {
+    if (Is_space(text[i])) {
+      in_token = 0;
+    } else if (!in_token) {
+      in_token = 1;
+      count++;
+    } else if ((text[i] == '-' || text[i] == '+') && Is_digit(text[i - 1])) {
+      count++;
+    }
+  }
+  return count;
+}  /* Count_keys */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Parse_keys
+ * Purpose:     Parse up to limit keys of text[begin, end) into dest the
+ *              way a fscanf("%d") loop reads them
+ * In arg:      text, begin, end, size (of the whole text), limit
+ * Out arg:     dest, stopped (1 if the loop would have stopped in the
+ *              range, after the keys stored)
+ * Return val:  Keys stored
+ */
+static size_t Parse_keys(const unsigned char *text, size_t begin, size_t end,
+    size_t size, int *dest, size_t limit, int *stopped) {
+  size_t count = 0, i = begin;
+  uint64_t value;
+  int negative, digits;
+
+  // Only the SIMD path reads on past end, as far as the text goes
+  (void) size;
+  *stopped = 0;
+  while (count < limit) {
+    // Skip the white space before the next token
+#if defined(__AVX2__)
+    uint32_t token;
+
+    while (i + 32 <= end && (token = ~Space_mask(text + i)) == 0) {
+      i += 32;
+    }
+    if (i + 32 <= end) {
+      i += __builtin_ctz(token);
+    }
+#endif
+    while (i < end && Is_space(text[i])) {
+      i++;
+    }
+    if (i == end) {
+      break;
+    }
+
+    negative = text[i] == '-';
+    if (text[i] == '-' || text[i] == '+') {
+      i++;
+    }
+    value = 0;
+    digits = 0;
+#if defined(__AVX2__)
+    // Ten digits cover every int; longer runs (leading zeros) and the
+    // last bytes of the file go the plain way
+    if (i + 16 <= size) {
+      digits = Digit_count(text + i);
+      if (digits > 0 && digits <= 10) {
+        value = Digits_value(text + i, digits);
+        i += digits;
+      } else {
+        digits = 0;
+      }
+    }
+#endif
+    if (digits == 0) {
+      while (i < end && Is_digit(text[i])) {
+        // Saturate far above any int so overflow cannot wrap
+        value = value < (1ull << 40) ? value * 10 + (text[i] - '0') : value;
+        i++;
+        digits++;
+      }
+    }
+    // No digits is a matching failure; an int overflow is undefined for
+    // fscanf and ends the input here too
+    if (digits == 0 ||
+        value > (negative ? (uint64_t) INT_MAX + 1 : (uint64_t) INT_MAX)) {
+      *stopped = 1;
+      break;
+    }
+    dest[count++] = negative ? (int) (-(int64_t) value) : (int) value;
+
+    // The next conversion starts right after the digits: white space or
+    // a sign begins the next number, anything else fails it
+    if (i < end && !Is_space(text[i]) && text[i] != '-' && text[i] != '+') {
+      *stopped = 1;
+      break;
+    }
+  }
+  return count;
+}  /* Parse_keys */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Parse_task
+ * Purpose:     One rank's pass over its byte range of the text
+ * In arg:      arg (parse_arg), rank
+ */
+static void Parse_task(void *arg, int rank) {
+  parse_arg *a = arg;
+  size_t begin = Range_start(a, rank), end = Range_start(a, rank + 1);
+  size_t offset, limit;
+
+  if (rank + 1 == a->thread_count) {
+    end = a->size;
+  }
+  if (a->pass == 0) {
+    a->counts[rank] = Count_keys(a->text, begin, end);
+    return;
+  }
+  offset = a->offsets[rank];
+  limit = offset < a->max_n ? a->max_n - offset : 0;
+  a->parsed[rank] = Parse_keys(a->text, begin, end, a->size,
+      a->dest + offset, limit < a->counts[rank] ? limit : a->counts[rank],
+      &a->stopped[rank]);
+}  /* Parse_task */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Input_parse_text
+ * Purpose:     Parse up to max_n keys of a text file into a new list
+ * In arg:      path, max_n, pool
+ * Out arg:     in
+ * Return val:  0 on success, -1 with errno set on failure
+ */
+int Input_parse_text(input_list *in, const char *path, size_t max_n,
+    thread_pool *pool) {
+  struct stat st;
+  parse_arg arg;
+  size_t total = 0;
+  int r;
+
+  memset(in, 0, sizeof(*in));
+  if (stat(path, &st) != 0) {
+    return -1;
+  }
+  if (st.st_size > 0) {
+    // The text is only read, so its pages are never copied
+    in->map = Map_file(path, 0, &in->map_size);
+    if (in->map == NULL) {
+      return -1;
+    }
+  }
+  arg.text = in->map;
+  arg.size = in->map_size;
+  arg.thread_count = pool != NULL ? Pool_size(pool) : 1;
+  arg.max_n = max_n;
+  arg.counts = malloc(arg.thread_count * sizeof(size_t));
+  arg.offsets = malloc(arg.thread_count * sizeof(size_t));
+  arg.parsed = malloc(arg.thread_count * sizeof(size_t));
+  arg.stopped = malloc(arg.thread_count * sizeof(int));
+  if (arg.counts == NULL || arg.offsets == NULL || arg.parsed == NULL ||
+      arg.stopped == NULL) {
+    errno = ENOMEM;
+    goto fail;
+  }
+
+  // Count, so every rank knows where its keys start in the list
+  arg.pass = 0;
+  if (pool != NULL) {
+    Pool_run(pool, arg.thread_count, Parse_task, &arg);
+  } else {
+    Parse_task(&arg, 0);
+  }
+  for (r = 0; r < arg.thread_count; r++) {
+    arg.offsets[r] = total;
+    total += arg.counts[r];
+  }
+  total = total < max_n ? total : max_n;
+
+  // The list is left untouched here, so each stretch of it is first
+  // written by the rank that parses it
+  in->owned = malloc((total > 0 ? total : 1) * sizeof(int));
+  if (in->owned == NULL) {
+    errno = ENOMEM;
+    goto fail;
+  }
+  arg.dest = in->owned;
+  arg.pass = 1;
+  if (pool != NULL) {
+    Pool_run(pool, arg.thread_count, Parse_task, &arg);
+  } else {
+    Parse_task(&arg, 0);
+  }
+
+  // Keep the keys up to the first bad token, as a fscanf loop would
+  in->n = 0;
+  for (r = 0; r < arg.thread_count; r++) {
+    in->n += arg.parsed[r];
+    if (arg.parsed[r] < arg.counts[r] || arg.stopped[r]) {
+      break;
+    }
+  }
+  in->n = in->n < total ? in->n : total;
+  in->list = in->owned;
+
+  free(arg.counts);
+  free(arg.offsets);
+  free(arg.parsed);
+  free(arg.stopped);
+  if (in->map != NULL) {
+    munmap(in->map, in->map_size);
+    in->map = NULL;
+  }
+  return 0;
+
+fail:
+  free(arg.counts);
+  free(arg.offsets);
+  free(arg.parsed);
+  free(arg.stopped);
+  Input_free(in);
+  return -1;
+}  /* Input_parse_text */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Input_free
+ * Purpose:     Release the mapping or the copy behind a loaded list
+ * In arg:      in
+ */
+void Input_free(input_list *in) {
+  if (in->map != NULL) {
+    munmap(in->map, in->map_size);
+  }
+  free(in->owned);
+  memset(in, 0, sizeof(*in));
+}  /* Input_free */
@@ -0,0 +1,90 @@
+/* File:       input.h
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Loading the list to sort from a file without a per-element
+ *             fscanf. A binary file is memory-mapped and either sorted
+ *             straight from the mapping or converted into a list by the
+ *             threads of a pool; a text file is mapped and parsed by the
+ *             threads of a pool, each into its own stretch of the list.
+ *
+ * Binary:     A 16-byte header followed by the keys, all little-endian:
+ *               bytes 0-3   magic "PSSB"
+ *               bytes 4-7   width of a key in bytes, 4 or 8
+ *               bytes 8-15  number of keys
+ *             The sort works on int, so 8-byte keys are narrowed and a
+ *             key outside the int range fails the load with ERANGE.
+ *
+ * Text:       Integers read as a fscanf("%d") loop reads them: white
+ *             space between numbers is optional before a sign ("12-5" is
+ *             12 and -5), and the loop stops where a number cannot start,
+ *             keeping the keys before it and the leading digits of the
+ *             token it stops in ("1 2 12abc 5" gives 1 2 12). A number
+ *             outside the int range, which fscanf leaves undefined, stops
+ *             parsing before it. Built with -mavx2 (or -march=native
+ *             on such a CPU) the parser classifies 32 bytes at a time and
+ *             converts digits with SIMD multiply-adds; otherwise it runs
+ *             plain C.
+ *
+ * Example:
+ *    input_list in;
+ *    if (Input_is_binary(path)) Input_map_binary(&in, path, max_n, pool);
+ *    else Input_parse_text(&in, path, max_n, pool);
+ *    sample_sort(in.list, in.n, &opts);
+ *    Input_free(&in);
+ */
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include <stddef.h>
+#include "thread_pool.h"
+
+typedef struct {
+  int *list;           // The keys, writable; sort them in place
+  size_t n;
+  void *map;           // Mapping list points into, or NULL
+  size_t map_size;
+  int *owned;          // Allocated copy list points to, or NULL
+} input_list;
+
+/*--------------------------------------------------------------------
+ * Function:    Input_is_binary
+ * Purpose:     Whether a file starts with the binary header's magic
+ * In arg:      path
+ */
+int Input_is_binary(const char *path);
+
+/*--------------------------------------------------------------------
+ * Function:    Input_map_binary
+ * Purpose:     Load up to max_n keys of a binary file. Native 4-byte keys
+ *              on a little-endian host are sorted in a private mapping
+ *              of the file (copy-on-write, the file never changes);
+ *              anything else is converted in parallel into a new list,
+ *              each rank filling the chunk it will later sort
+ * In arg:      path, max_n, pool (NULL converts on the calling thread)
+ * Out arg:     in
+ * Return val:  0 on success, -1 with errno set on failure
+ */
+int Input_map_binary(input_list *in, const char *path, size_t max_n,
+    thread_pool *pool);
+
+/*--------------------------------------------------------------------
+ * Function:    Input_parse_text
+ * Purpose:     Parse up to max_n keys of a text file into a new list. The
+ *              file is cut into one byte range per rank at white space;
+ *              every rank counts the keys of its range, then parses them
+ *              into its stretch of the list, which it touches first
+ * In arg:      path, max_n, pool (NULL parses on the calling thread)
+ * Out arg:     in
+ * Return val:  0 on success, -1 with errno set on failure
+ */
+int Input_parse_text(input_list *in, const char *path, size_t max_n,
+    thread_pool *pool);
+
+/*--------------------------------------------------------------------
+ * Function:    Input_free
+ * Purpose:     Release the mapping or the copy behind a loaded list
+ * In arg:      in
+ */
+void Input_free(input_list *in);
+
+#endif
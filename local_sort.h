@@ -0,0 +1,134 @@
+/* File:       local_sort.h
+ *
+ * Purpose:    Define a macro that generates an introsort specialized for
+ *             one key type and one comparison, so the comparison is
+ *             inlined instead of going through qsort's function pointer.
+ *
+ * Note:       less(a, b) must be an expression that is true when a sorts
+ *             strictly before b; it is expanded inline and may evaluate
+ *             its arguments more than once.
+ *
+ * Example:
+ *    #include "local_sort.h"
+ *    #define INT_LESS(a, b) ((a) < (b))
+ *    DEFINE_INTROSORT(Int_sort, int, INT_LESS)
+ *    . . .
+ *    Int_sort(list, list_size);
+ *
+ * Algorithm:  Quicksort with a median-of-three pivot and a Hoare
+ *             partition that uses the sorted outer elements as sentinels.
+ *             The smaller side recurses, the larger loops. Partitions of
+ *             INTRO_THRESHOLD elements or fewer are finished by insertion
+ *             sort, and recursion deeper than 2*log2(n) falls back to
+ *             heapsort, so the worst case stays O(n log n).
+ *
+ *             name##_partition (one median-of-three partition step, for
+ *             n > INTRO_THRESHOLD) and name##_loop (the depth limited
+ *             sort) are generated as well, so a scheduler can split a
+ *             large range into independently sortable parts.
+ */
+#ifndef _LOCAL_SORT_H_
+#define _LOCAL_SORT_H_
+
+#include <stddef.h>
+
+#define INTRO_THRESHOLD 16
+
+#define DEFINE_INTROSORT(name, type, less)                                   \
+                                                                             \
+static void name##_insertion(type *a, size_t n) {                            \
+  size_t i, j;                                                               \
+  for (i = 1; i < n; i++) {                                                  \
+    type v = a[i];                                                           \
+    for (j = i; j > 0 && less(v, a[j - 1]); j--) {                           \
+      a[j] = a[j - 1];                                                       \
+    }                                                                        \
+    a[j] = v;                                                                \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+static void name##_sift(type *a, size_t root, size_t n) {                    \
+  type v = a[root];                                                          \
+  size_t child;                                                              \
+  while ((child = 2 * root + 1) < n) {                                       \
+    if (child + 1 < n && less(a[child], a[child + 1])) {                     \
+      child++;                                                               \
+    }                                                                        \
+    if (!less(v, a[child])) {                                                \
+      break;                                                                 \
+    }                                                                        \
+    a[root] = a[child];                                                      \
+    root = child;                                                            \
+  }                                                                          \
+  a[root] = v;                                                               \
+}                                                                            \
+                                                                             \
+static void name##_heapsort(type *a, size_t n) {                             \
+  size_t i;                                                                  \
+  type t;                                                                    \
+  for (i = n / 2; i-- > 0;) {                                                \
+    name##_sift(a, i, n);                                                    \
+  }                                                                          \
+  for (i = n; i-- > 1;) {                                                    \
+    t = a[0]; a[0] = a[i]; a[i] = t;                                         \
+    name##_sift(a, 0, i);                                                    \
+  }                                                                          \
+}                                                                            \
+                                                                             \
+static void name##_partition(type *a, size_t n, size_t *left_n,          \
+    size_t *right_start) {                                                   \
+  size_t i, j, mid;                                                          \
+  type t, pivot;                                                             \
+  /* Order first, middle and last so the outer two act as sentinels */       \
+  mid = n / 2;                                                               \
+  if (less(a[mid], a[0])) { t = a[mid]; a[mid] = a[0]; a[0] = t; }           \
+  if (less(a[n - 1], a[mid])) {                                              \
+    t = a[mid]; a[mid] = a[n - 1]; a[n - 1] = t;                             \
+    if (less(a[mid], a[0])) { t = a[mid]; a[mid] = a[0]; a[0] = t; }         \
+  }                                                                          \
+  pivot = a[mid];                                                            \
+  i = 0;                                                                     \
+  j = n - 1;                                                                 \
+  for (;;) {                                                                 \
+    do { i++; } while (less(a[i], pivot));                                   \
+    do { j--; } while (less(pivot, a[j]));                                   \
+    if (i >= j) {                                                            \
+      break;                                                                 \
+    }                                                                        \
+    t = a[i]; a[i] = a[j]; a[j] = t;                                         \
+  }                                                                          \
+  /* [0, i) <= pivot <= [j + 1, n); both sides are shorter than n */         \
+  *left_n = i;                                                               \
+  *right_start = j + 1;                                                      \
+}                                                                            \
+                                                                             \
+static void name##_loop(type *a, size_t n, int depth) {                      \
+  size_t left_n, right_start;                                                \
+  while (n > INTRO_THRESHOLD) {                                              \
+    if (depth-- == 0) {                                                      \
+      name##_heapsort(a, n);                                                 \
+      return;                                                                \
+    }                                                                        \
+    name##_partition(a, n, &left_n, &right_start);                           \
+    if (left_n < n - right_start) {                                          \
+      name##_loop(a, left_n, depth);                                         \
+      a += right_start;                                                      \
+      n -= right_start;                                                      \
+    } else {                                                                 \
+      name##_loop(a + right_start, n - right_start, depth);                  \
+      n = left_n;                                                            \
+    }                                                                        \
+  }                                                                          \
+  name##_insertion(a, n);                                                    \
+}                                                                            \
+                                                                             \
+static inline void name(type *a, size_t n) {                                 \
+  int depth = 0;                                                             \
+  size_t m;                                                                  \
+  for (m = n; m > 1; m >>= 1) {                                              \
+    depth += 2;                                                              \
+  }                                                                          \
+  name##_loop(a, n, depth);                                                  \
+}
+
+#endif
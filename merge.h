@@ -0,0 +1,199 @@
+/* File:       merge.h
+ *
+ * Purpose:    K-way merge of sorted int runs through a loser tree, writing
+ *             straight into the destination array.
+ *
+ * Example:
+ *    merge_run runs[3] = {{a, a + na}, {b, b + nb}, {c, c + nc}};
+ *    Merge_runs(runs, 3, out);        // out receives na + nb + nc keys
+ *
+ * Algorithm:  The k runs sit at the leaves of a complete binary tree
+ *             padded to a power of two with empty runs. Every internal
+ *             node remembers the loser of the match played there and
+ *             tree[0] the overall winner, so after emitting the winner's
+ *             head only the matches on its leaf-to-root path are
+ *             replayed: log2(k) comparisons per output key. An exhausted
+ *             run loses every match, which avoids needing a sentinel key
+ *             (INT_MAX may be a real key).
+ *
+ *             Select_cuts splits k sorted runs at a global rank r: it
+ *             binary searches the key range for the smallest value v with
+ *             at least r keys <= v (each count is k binary searches), cuts
+ *             every run before v and hands out the remaining copies of v
+ *             in run order. Cuts for a larger rank are never left of the
+ *             cuts for a smaller one, so consecutive ranks delimit slices
+ *             that can be merged independently.
+ */
+#ifndef _MERGE_H_
+#define _MERGE_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+typedef struct {
+  const int *cur, *end;
+} merge_run;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Run_beats
+ * Purpose:     Whether run a's head goes out before run b's
+ * In arg:      runs, a, b
+ */
+static inline int Run_beats(const merge_run *runs, int a, int b) {
+  if (runs[a].cur == runs[a].end) {
+    return 0;
+  }
+  if (runs[b].cur == runs[b].end) {
+    return 1;
+  }
+  return *runs[a].cur < *runs[b].cur;
+}  /* Run_beats */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Merge_runs
+ * Purpose:     Merge k sorted runs into out
+ * In arg:      k
+ * In/out arg:  runs (consumed), out
+ * Return val:  0 on success, -1 if the tree could not be allocated
+ */
+static int Merge_runs(merge_run *runs, int k, int *out) {
+  merge_run *leaves;
+  int *tree, *winner;
+  int size, node, w, t;
+  size_t total = 0;
+  int r;
+
+  for (r = 0; r < k; r++) {
+    total += runs[r].end - runs[r].cur;
+  }
+  if (k == 1) {
+    memcpy(out, runs[0].cur, total * sizeof(int));
+    return 0;
+  }
+
+  size = 1;
+  while (size < k) {
+    size <<= 1;
+  }
+  leaves = calloc(size, sizeof(merge_run));
+  tree = malloc(size * sizeof(int));
+  winner = malloc(2 * size * sizeof(int));
+  if (leaves == NULL || tree == NULL || winner == NULL) {
+    free(leaves);
+    free(tree);
+    free(winner);
+    return -1;
+  }
+  memcpy(leaves, runs, k * sizeof(merge_run));
+
+  // Play the initial tournament bottom up, keeping losers in tree[]
+  for (node = 0; node < size; node++) {
+    winner[size + node] = node;
+  }
+  for (node = size - 1; node >= 1; node--) {
+    int a = winner[2 * node], b = winner[2 * node + 1];
+    if (Run_beats(leaves, b, a)) {
+      winner[node] = b;
+      tree[node] = a;
+    } else {
+      winner[node] = a;
+      tree[node] = b;
+    }
+  }
+  w = winner[1];
+
+  while (total-- > 0) {
+    *out++ = *leaves[w].cur++;
+    // Replay the matches from the winner's leaf to the root
+    for (node = (w + size) >> 1; node >= 1; node >>= 1) {
+      if (Run_beats(leaves, tree[node], w)) {
+        t = tree[node];
+        tree[node] = w;
+        w = t;
+      }
+    }
+  }
+
+  memcpy(runs, leaves, k * sizeof(merge_run));
+  free(leaves);
+  free(tree);
+  free(winner);
+  return 0;
+}  /* Merge_runs */
+
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Run_lower
+ * Purpose:     Number of keys in run[0..n) that are less than key
+ * In arg:      run, n, key
+ */
+static inline size_t Run_lower(const int *run, size_t n, long long key) {
+  size_t lo = 0, hi = n, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (run[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}  /* Run_lower */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Select_cuts
+ * Purpose:     Split k sorted runs so the rank smallest keys lie left
+ *              of the cuts
+ * In arg:      runs, k, rank (at most the total run length)
+ * Out arg:     cuts (cuts[r] keys of run r lie left)
+ */
+static void Select_cuts(const merge_run *runs, int k, size_t rank, size_t *cuts) {
+  long long lo = INT_MIN, hi = INT_MAX, mid;
+  size_t below, len, extra;
+  int r;
+
+  if (rank == 0) {
+    memset(cuts, 0, k * sizeof(size_t));
+    return;
+  }
+  // Smallest v with at least rank keys <= v
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    below = 0;
+    for (r = 0; r < k; r++) {
+      below += Run_lower(runs[r].cur, runs[r].end - runs[r].cur, mid + 1);
+    }
+    if (below >= rank) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  // Everything below v goes left, then copies of v in run order
+  below = 0;
+  for (r = 0; r < k; r++) {
+    cuts[r] = Run_lower(runs[r].cur, runs[r].end - runs[r].cur, lo);
+    below += cuts[r];
+  }
+  for (r = 0; r < k && below < rank; r++) {
+    len = runs[r].end - runs[r].cur;
+    extra = Run_lower(runs[r].cur, len, lo + 1) - cuts[r];
+    if (extra > rank - below) {
+      extra = rank - below;
+    }
+    cuts[r] += extra;
+    below += extra;
+  }
+}  /* Select_cuts */
+
+#endif
@@ -0,0 +1,148 @@
+/* File:       radix_sort.h
+ *
+ * Purpose:    LSD radix sort for int keys that ping-pongs between the
+ *             input and a caller supplied scratch array of the same size,
+ *             so the radix passes never allocate.
+ *
+ * Note:       The sorted keys end up in either the input or the scratch
+ *             array depending on how many passes ran; Radix_sort returns
+ *             whichever one holds them.
+ *
+ * Example:
+ *    int *sorted = Radix_sort(list, scratch, list_size);
+ *    if (sorted != list) memcpy(list, sorted, list_size * sizeof(int));
+ *
+ * Algorithm:  Keys are viewed as unsigned offsets from a lower bound lo,
+ *             which maps lo..INT_MAX onto 0..UINT_MAX-lo in order (for
+ *             lo = INT_MIN this is just flipping the sign bit). One read
+ *             pass builds the histograms of every digit; a digit on which
+ *             every key agrees (its histogram has a single bucket holding
+ *             all n keys) is skipped without moving data.
+ *
+ *             Range_sort uses a known key range [lo, hi] to run only the
+ *             digits that span covers, or, when the range is no wider
+ *             than the list and at most RANGE_COUNT_LIMIT values, a direct
+ *             counting sort that rewrites the keys in place.
+ */
+#ifndef _RADIX_SORT_H_
+#define _RADIX_SORT_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES ((int) (32 / RADIX_BITS))
+#define RANGE_COUNT_LIMIT (1 << 16)
+
+#define RADIX_DIGIT(u, pass) (((u) >> ((pass) * RADIX_BITS)) & (RADIX_BUCKETS - 1))
+
+/*--------------------------------------------------------------------
+ * Function:    Radix_passes
+ * Purpose:     LSD sort on the low passes digits of a[i] - lo
+ * In arg:      n, lo, passes
+ * In/out arg:  a, scratch
+ * Return val:  a or scratch, whichever holds the sorted keys
+ */
+static int *Radix_passes(int *a, int *scratch, size_t n, int lo, int passes) {
+  size_t count[RADIX_PASSES][RADIX_BUCKETS];
+  size_t i, sum, tmp;
+  unsigned u, bias = (unsigned) lo;
+  int pass, d, *src = a, *dst = scratch, *swap;
+
+  if (n < 2) {
+    return a;
+  }
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < n; i++) {
+    u = (unsigned) a[i] - bias;
+    for (pass = 0; pass < passes; pass++) {
+      count[pass][RADIX_DIGIT(u, pass)]++;
+    }
+  }
+
+  for (pass = 0; pass < passes; pass++) {
+    // All keys share this digit, the pass would be an identity copy
+    u = (unsigned) src[0] - bias;
+    if (count[pass][RADIX_DIGIT(u, pass)] == n) {
+      continue;
+    }
+    // Turn the histogram into exclusive bucket offsets
+    sum = 0;
+    for (d = 0; d < RADIX_BUCKETS; d++) {
+      tmp = count[pass][d];
+      count[pass][d] = sum;
+      sum += tmp;
+    }
+    for (i = 0; i < n; i++) {
+      u = (unsigned) src[i] - bias;
+      dst[count[pass][RADIX_DIGIT(u, pass)]++] = src[i];
+    }
+    swap = src;
+    src = dst;
+    dst = swap;
+  }
+  return src;
+}  /* Radix_passes */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Radix_sort
+ * Purpose:     Sort a[0..n) ascending using scratch[0..n) as the
+ *              other half of the ping-pong
+ * In arg:      n
+ * In/out arg:  a, scratch
+ * Return val:  a or scratch, whichever holds the sorted keys
+ */
+static int *Radix_sort(int *a, int *scratch, size_t n) {
+  return Radix_passes(a, scratch, n, INT_MIN, RADIX_PASSES);
+}  /* Radix_sort */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Range_sort
+ * Purpose:     Sort a[0..n), whose keys all lie in [lo, hi], with as
+ *              little work as that range allows
+ * In arg:      n, lo, hi
+ * In/out arg:  a, scratch
+ * Return val:  a or scratch, whichever holds the sorted keys
+ */
+static int *Range_sort(int *a, int *scratch, size_t n, int lo, int hi) {
+  unsigned span = (unsigned) hi - (unsigned) lo;
+  size_t *count, i, j, v;
+  int passes;
+
+  if (n < 2 || lo >= hi) {
+    return a;
+  }
+
+  // Small range: count each value and write the runs back directly
+  if (span < RANGE_COUNT_LIMIT && span < n) {
+    count = calloc((size_t) span + 1, sizeof(size_t));
+    if (count != NULL) {
+      for (i = 0; i < n; i++) {
+        count[(unsigned) a[i] - (unsigned) lo]++;
+      }
+      for (v = 0, i = 0; v <= span; v++) {
+        for (j = 0; j < count[v]; j++) {
+          a[i++] = (int) ((unsigned) lo + v);
+        }
+      }
+      free(count);
+      return a;
+    }
+  }
+
+  // Otherwise only the digits the range needs
+  passes = 1;
+  while (passes < RADIX_PASSES && (span >> (passes * RADIX_BITS)) != 0) {
+    passes++;
+  }
+  return Radix_passes(a, scratch, n, lo, passes);
+}  /* Range_sort */
+
+#endif
@@ -0,0 +1,119 @@
+/* File:       rng.h
+ *
+ * Purpose:    Small per-thread pseudo-random generator (xoshiro256**) for
+ *             drawing samples: no shared state, no locks, and a seed plus
+ *             a stream number always give the same sequence.
+ *
+ * Note:       Each stream's state is four splitmix64 outputs of the seed
+ *             mixed with the stream number, so streams with different
+ *             numbers start at unrelated points of the 2^256 - 1 period.
+ *
+ * Example:
+ *    rng r;
+ *    Rng_seed(&r, seed, rank);         // one stream per thread
+ *    x = Rng_next(&r);                 // 64 random bits
+ *    i = Rng_below(&r, n);             // uniform in [0, n), n > 0
+ *
+ * Algorithm:  Blackman and Vigna, "Scrambled Linear Pseudorandom Number
+ *             Generators" (ACM TOMS 2021). Rng_below is Lemire's
+ *             multiply-and-reject ("Fast Random Integer Generation in an
+ *             Interval", ACM TOMACS 2019), which is unbiased and needs a
+ *             division only when a draw lands in the rejection zone.
+ */
+#ifndef _RNG_H_
+#define _RNG_H_
+
+#include <stdint.h>
+
+typedef struct {
+  uint64_t s[4];
+} rng;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Rng_mix
+ * Purpose:     Advance a splitmix64 state and return its next output
+ * In/out arg:  x
+ */
+static inline uint64_t Rng_mix(uint64_t *x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}  /* Rng_mix */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Rng_seed
+ * Purpose:     Start stream number stream of the sequence for seed
+ * In arg:      seed, stream
+ * Out arg:     r
+ */
+static inline void Rng_seed(rng *r, uint64_t seed, uint64_t stream) {
+  uint64_t x = stream;
+  int i;
+
+  x = seed ^ Rng_mix(&x);
+  for (i = 0; i < 4; i++) {
+    r->s[i] = Rng_mix(&x);
+  }
+}  /* Rng_seed */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Rng_next
+ * Purpose:     Next 64 random bits of a stream
+ * In/out arg:  r
+ */
+static inline uint64_t Rng_next(rng *r) {
+  uint64_t *s = r->s;
+  uint64_t x = s[1] * 5;
+  uint64_t result = ((x << 7) | (x >> 57)) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = (s[3] << 45) | (s[3] >> 19);
+  return result;
+}  /* Rng_next */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Rng_below
+ * Purpose:     Uniform random integer in [0, bound)
+ * In arg:      bound (> 0)
+ * In/out arg:  r
+ */
+static inline uint64_t Rng_below(rng *r, uint64_t bound) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 m = (unsigned __int128) Rng_next(r) * bound;
+  uint64_t low = (uint64_t) m, threshold;
+
+  if (low < bound) {
+    // The low 2^64 mod bound products would favour some results
+    threshold = -bound % bound;
+    while (low < threshold) {
+      m = (unsigned __int128) Rng_next(r) * bound;
+      low = (uint64_t) m;
+    }
+  }
+  return (uint64_t) (m >> 64);
+#else
+  // Reject the lowest 2^64 mod bound values, then reduce
+  uint64_t threshold = -bound % bound, x;
+
+  do {
+    x = Rng_next(r);
+  } while (x < threshold);
+  return x % bound;
+#endif
+}  /* Rng_below */
+
+#endif
@@ -0,0 +1,1800 @@
+/* File:       sample_sort.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Reentrant implementation of the Pthreads sample sort declared
+ *             in sample_sort.h.
+ *
+ * Compile:    gcc -g -Wall -c sample_sort.c
+ *
+ * Algorithm:  Each call builds a sort_ctx holding everything the threads
+ *             share (sample keys, splitters, the distribution arrays and
+ *             the scratch list). Every thread then runs Thread_work on its
+ *             block of the list: locating sample keys, generating
+ *             splitters, sorting local data blocks, computing the
+ *             distribution arrays, assigning items to buckets and
+ *             eventually sorting its bucket straight into the caller's
+ *             array. Between phases a thread waits only for the steps
+ *             its next phase reads, counted in ctx->deps, not for the
+ *             whole team at a barrier. For further in-depth details, please refer to
+ *             http://www.cs.usfca.edu/~peter/cs625/prog3.pdf and
+ *             http://en.wikipedia.org/wiki/Samplesort.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "timer.h"
+#include "barrier.h"
+#include "classifier.h"
+#include "local_sort.h"
+#include "merge.h"
+#include "radix_sort.h"
+#include "rng.h"
+#include "scan.h"
+#include "spin.h"
+#include "ws_deque.h"
+#include "write_combine.h"
+#include "sample_sort.h"
+
+#define DEFAULT_SAMPLES_PER_THREAD 16
+// Under SCHEDULE_STEAL, introsort ranges above this are split into tasks
+#define STEAL_SPLIT (1 << 14)
+// Buckets smaller than this are never worth a nested parallel sort
+#define NESTED_MIN (1 << 16)
+// Nested sorts of nested sorts stop here
+#define MAX_NEST_DEPTH 2
+// Keys per block under PARTITION_INPLACE (2 KiB, as in IPS4o)
+#define INPLACE_BLOCK 512
+
+// Barrier between the phases, chosen at compile time: -DSORT_SPIN_BARRIER,
+// -DSORT_TREE_BARRIER or -DSORT_DISSEMINATION_BARRIER pick one of
+// barrier.h, otherwise pthread_barrier_t
+#if defined(SORT_SPIN_BARRIER)
+typedef spin_barrier sort_barrier;
+#define Barrier_init(b, count) Spin_barrier_init(b, count)
+#define Barrier_wait(b, rank) Spin_barrier_wait(b)
+#define Barrier_destroy(b) Spin_barrier_destroy(b)
+#elif defined(SORT_TREE_BARRIER)
+typedef tree_barrier sort_barrier;
+#define Barrier_init(b, count) Tree_barrier_init(b, count, 0)
+#define Barrier_wait(b, rank) Tree_barrier_wait(b, rank)
+#define Barrier_destroy(b) Tree_barrier_destroy(b)
+#elif defined(SORT_DISSEMINATION_BARRIER)
+typedef dissemination_barrier sort_barrier;
+#define Barrier_init(b, count) Dissemination_barrier_init(b, count)
+#define Barrier_wait(b, rank) Dissemination_barrier_wait(b, rank)
+#define Barrier_destroy(b) Dissemination_barrier_destroy(b)
+#else
+typedef pthread_barrier_t sort_barrier;
+#define Barrier_init(b, count) pthread_barrier_init(b, NULL, count)
+#define Barrier_wait(b, rank) pthread_barrier_wait(b)
+#define Barrier_destroy(b) pthread_barrier_destroy(b)
+#endif
+
+// Scan of the bucket starts, chosen at compile time: -DSORT_BLOCKED_SCAN
+// picks the two-pass scan of scan.h, otherwise the look-back scan, which
+// lets the threads that get there first do all of it
+#if defined(SORT_BLOCKED_SCAN)
+typedef blocked_scan sort_scan;
+#define Scan_init(s, n, count) Blocked_scan_init(s, count)
+#define Scan_run(s, in, out, n, rank) Blocked_scan(s, in, out, n, rank)
+#define Scan_free(s) Blocked_scan_free(s)
+#else
+typedef lookback_scan sort_scan;
+#define Scan_init(s, n, count) Lookback_scan_init(s, n, SCAN_TILE)
+#define Scan_run(s, in, out, n, rank) Lookback_scan(s, in, out, n)
+#define Scan_free(s) Lookback_scan_free(s)
+#endif
+
+// A bucket and its size, for ordering the bucket queue
+typedef struct {
+  size_t size;
+  int bucket;
+} bucket_ref;
+
+// A unit of stealable work: a whole bucket, or part of one being sorted
+typedef struct {
+  int bucket;            // Bucket to gather and sort, -1 for a subrange
+  int depth;             // Partition steps left before sorting serially
+  int *base;
+  size_t n;
+} sort_task;
+
+// One bucket's region of block slots during the in-place permutation;
+// slot j is list[j*INPLACE_BLOCK, (j+1)*INPLACE_BLOCK)
+typedef struct {
+  size_t write;          // Next slot to fill with a block of this bucket
+  size_t read;           // End of the full slots not yet picked up
+  size_t spill;          // Keys of the last block past the bucket's end
+  atomic_flag lock;      // Guards write and read
+} bucket_slots;
+
+// One thread's timestamps for the bucket phase
+typedef struct {
+  double start, busy, end;
+} phase_time;
+
+// Completion counts standing in for barriers between the phases: each
+// step a thread finishes is posted, and a thread waits only for the
+// steps its next one actually reads
+typedef struct {
+  atomic_int samples;    // Threads whose sample run is drawn and sorted
+  atomic_int *slices;    // Per thread: 1 once its slice of sorted_keys is merged
+  atomic_int splitters;  // Threads done with their splitters
+  atomic_int runs;       // Sorted chunks in sorted_runs (exact)
+  atomic_int cut;        // Threads done with their raw_dist columns (exact)
+  atomic_int rows;       // Rows of raw_dist and prefix_dist complete
+  atomic_int cols;       // Threads done with their col_dist columns
+  atomic_int starts;     // Threads done with their part of the start scan
+  atomic_int order;      // 1 once bucket_order is set
+  atomic_int scattered;  // Chunks scattered into tmp_list (classify)
+  atomic_int launched;   // Without a pool: 1 once every thread was
+                         // created, or creating one failed
+} phase_deps;
+
+// Everything one sort shares between its threads
+typedef struct sort_ctx {
+  int *list;             // Input, also receives the sorted output
+  int *tmp_list;         // Classified keys at their final index, or radix
+                         // scratch for the sorted chunks
+  int *sorted_list;      // Output, aliases list
+  int *sample_keys, *sorted_keys, *splitters;
+  unsigned char *equal_bucket;   // Bucket holds copies of one key only
+  const int **sorted_runs;       // Each thread's sorted chunk, when exact
+  atomic_int runs_in_tmp;        // Some sorted chunk lies in tmp_list
+  merge_run *cut_runs;           // Exact: thread_count runs per thread
+  size_t *cut_ranks;             // Exact: 2 * thread_count cuts per thread
+  int *block_buf;                // In place: a block per thread and bucket
+  int *swap_buf;                 // In place: two blocks per thread
+  int *spill_buf;                // In place: a block per bucket
+  int *overflow;                 // In place: the slot past the list's end
+  size_t *full_blocks;           // In place: blocks each thread flushed
+  bucket_slots *slots;           // In place: one per bucket
+  int *class_trees;              // Classify, in place: a classifier
+                                 // tree per thread (classifier.h)
+  bucket_id *bucket_of;          // Classify: bucket of every list key
+  size_t *scatter_next;          // Classify: per thread and bucket, the
+                                 // tmp_list index its next key goes to
+  size_t *raw_dist, *prefix_dist, *col_dist;
+  size_t *start_dist;            // Bucket-major: [b*p + t] is where thread
+                                 // t's keys of bucket b start, then n
+  sort_scan start_scan;          // Fills start_dist
+  size_t list_size;
+  int thread_count, bucket_count, sample_size;
+  bucket_ref *bucket_order;      // Buckets by decreasing size
+  atomic_int next_bucket;        // Head of the bucket queue
+  bucket_schedule schedule;
+  scatter_mode scatter;
+  ws_deque *deques;              // SCHEDULE_STEAL: one per thread
+  sort_task *bucket_tasks;       // SCHEDULE_STEAL: one per bucket
+  atomic_long tasks_left;        // SCHEDULE_STEAL: queued or running tasks
+  phase_time *times;
+  phase_deps deps;
+  sort_opts opts;                // Effective options, reused when nesting
+  int depth;                     // 0 for the caller's sort, +1 per nesting
+  size_t nested_threshold;       // Larger buckets are sorted by the team
+  int *big_buckets;              // Oversized buckets, gathered but unsorted
+  atomic_int big_count;
+  struct sort_ctx *nested;       // Context of the nested sort in progress
+  int nested_ok;
+  int owns_tmp;                  // tmp_list was allocated by this context
+  sort_kernel local_kernel, bucket_kernel;
+  partition_mode partition;
+  sample_mode sampling;
+  sort_barrier *barrier;         // Shared by nested sorts of the team
+  int launch_failed;             // A thread could not be created
+} sort_ctx;
+
+// Argument handed to each thread
+typedef struct {
+  sort_ctx *ctx;
+  long rank;
+} thread_arg;
+
+static void Sort_bucket(sort_ctx *ctx, int bucket, int rank);
+static void Sort_phases(sort_ctx *ctx, long my_rank);
+static void *Thread_work(void *arg);
+static int Ctx_init(sort_ctx *ctx, int *data, size_t n, const sort_opts *opts,
+    int *scratch, int depth);
+static void Ctx_free(sort_ctx *ctx);
+static void Pool_work(void *ctx, int rank);
+
+
+/*--------------------------------------------------------------------
+ * Function:    Sort_opts_init
+ * Purpose:     Fill opts with the defaults used when sample_sort gets NULL
+ * Out arg:     opts
+ */
+void Sort_opts_init(sort_opts *opts) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  opts->thread_count = cpus > 0 ? (int) cpus : 1;
+  opts->sample_size = opts->thread_count * DEFAULT_SAMPLES_PER_THREAD;
+  opts->pool = NULL;
+  opts->local_kernel = SORT_INTRO;
+  opts->bucket_kernel = SORT_INTRO;
+  opts->partition = PARTITION_SORTED;
+  opts->sampling = SAMPLE_RANDOM;
+  opts->bucket_count = 0;
+  opts->schedule = SCHEDULE_QUEUE;
+  opts->stats = NULL;
+  opts->nested_threshold = 0;
+  opts->scatter = SCATTER_PLAIN;
+  opts->seed = 1;
+}  /* Sort_opts_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Chunk_start
+ * Purpose:     First list index of a thread's block; blocks differ in
+ *              size by at most one so any list size can be split
+ * In arg:      ctx, rank
+ */
+static size_t Chunk_start(const sort_ctx *ctx, long rank) {
+  return (size_t) rank * ctx->list_size / ctx->thread_count;
+}  /* Chunk_start */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Dep_post
+ * Purpose:     Count one finished step, publishing everything the thread
+ *              wrote for it
+ * In/out arg:  count
+ */
+static void Dep_post(atomic_int *count) {
+  atomic_fetch_add_explicit(count, 1, memory_order_release);
+}  /* Dep_post */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Dep_wait
+ * Purpose:     Wait until target steps are posted to count, after which
+ *              everything written for them is visible
+ * In arg:      count, target
+ */
+static void Dep_wait(atomic_int *count, int target) {
+  Spin_wait_at_least(count, target);
+}  /* Dep_wait */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wait_slices
+ * Purpose:     Wait for the merged slices of sorted_keys that the
+ *              splitter and equality test of one bucket read
+ * In arg:      ctx, bucket
+ * Note:        Slice t holds sorted_keys[t*S/p, (t+1)*S/p), so index x
+ *              belongs to slice ((x+1)*p - 1) / S.
+ */
+static void Wait_slices(sort_ctx *ctx, int bucket) {
+  size_t lo, hi, p = ctx->thread_count, size = ctx->sample_size;
+  int t;
+
+  if (bucket == 0) {
+    return;
+  }
+  // Splitter_at reads the offsets of bucket - 1 and bucket, and
+  // Is_equal_bucket the splitter of bucket + 1 as well
+  lo = (size_t) (bucket > 1 ? bucket - 1 : bucket) * size / ctx->bucket_count;
+  hi = (size_t) (bucket + 1 < ctx->bucket_count ? bucket + 1 : bucket) *
+      size / ctx->bucket_count;
+  for (t = ((lo + 1) * p - 1) / size; t <= (int) (((hi + 1) * p - 1) / size); t++) {
+    Dep_wait(&ctx->deps.slices[t], 1);
+  }
+}  /* Wait_slices */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Splitter_at
+ * Purpose:     Lower bound of a bucket (1 <= bucket < bucket_count),
+ *              always a real sample key or one past a repeated one
+ * In arg:      ctx, bucket
+ * Note:        A key that already bounds the previous bucket is repeated
+ *              in the sample. Bumping every repeat to key + 1 leaves the
+ *              first bucket of the run holding key alone (an equality
+ *              bucket) and the rest of the run empty.
+ */
+static int Splitter_at(const sort_ctx *ctx, int bucket) {
+  size_t offset = (size_t) bucket * ctx->sample_size / ctx->bucket_count;
+  size_t prev = (size_t) (bucket - 1) * ctx->sample_size / ctx->bucket_count;
+  int key = ctx->sorted_keys[offset];
+
+  if (bucket > 1 && ctx->sorted_keys[prev] == key && key != INT_MAX) {
+    return key + 1;
+  }
+  return key;
+}  /* Splitter_at */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Is_equal_bucket
+ * Purpose:     Whether a bucket can only hold copies of one key, so it
+ *              is sorted as soon as it is gathered
+ * In arg:      ctx, bucket
+ */
+static int Is_equal_bucket(const sort_ctx *ctx, int bucket) {
+  long long lo;
+
+  if (bucket == 0) {
+    return 0;
+  }
+  lo = Splitter_at(ctx, bucket);
+  if (bucket == ctx->bucket_count - 1) {
+    return lo == INT_MAX;
+  }
+  return Splitter_at(ctx, bucket + 1) == lo + 1;
+}  /* Is_equal_bucket */
+
+
+
+// Inlined integer sort used for the local chunks and the buckets
+#define INT_LESS(a, b) ((a) < (b))
+DEFINE_INTROSORT(Int_sort, int, INT_LESS)
+
+// Bucket queue order, largest bucket first
+#define BIGGER_FIRST(a, b) ((a).size > (b).size)
+DEFINE_INTROSORT(Order_sort, bucket_ref, BIGGER_FIRST)
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Sort_keys
+ * Purpose:     Sort a[0..n) with the chosen kernel; scratch[0..n) is
+ *              memory the caller can spare as radix ping-pong space
+ * In arg:      kernel, n, lo, hi (bounds on the keys, INT_MIN and INT_MAX
+ *              when nothing is known)
+ * In/out arg:  a, scratch
+ * Return val:  a or scratch, whichever holds the sorted keys
+ */
+static int *Sort_keys(sort_kernel kernel, int *a, int *scratch, size_t n,
+    int lo, int hi) {
+  size_t i;
+
+  switch (kernel) {
+  case SORT_RADIX:
+    return Radix_sort(a, scratch, n);
+  case SORT_RANGE:
+    // Without known bounds one extra read pass finds the exact range
+    if (lo == INT_MIN && hi == INT_MAX && n > 0) {
+      lo = hi = a[0];
+      for (i = 1; i < n; i++) {
+        lo = a[i] < lo ? a[i] : lo;
+        hi = a[i] > hi ? a[i] : hi;
+      }
+    }
+    return Range_sort(a, scratch, n, lo, hi);
+  default:
+    Int_sort(a, n);
+    return a;
+  }
+}  /* Sort_keys */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Sort_chunk
+ * Purpose:     Copy a thread's block of the list and sort it; the same
+ *              block of tmp_list is used by no one else, so it serves as
+ *              radix scratch
+ * In arg:      ctx, local_pointer, local_chunk_size
+ * Out arg:     sorted_data (the copy or the tmp_list block, whichever
+ *              holds the sorted keys)
+ * Return val:  The copy, for the caller to free (NULL when it could not
+ *              be allocated and the chunk was sorted in tmp_list instead)
+ */
+static int *Sort_chunk(sort_ctx *ctx, size_t local_pointer,
+    size_t local_chunk_size, int **sorted_data) {
+  // Using block partition to retrieve and sort local chunk
+  int *local_data = malloc(local_chunk_size * sizeof(int));
+
+  // Out of memory: introsort needs no scratch, so sort in the tmp_list block
+  if (local_data == NULL) {
+    *sorted_data = ctx->tmp_list + local_pointer;
+    memcpy(*sorted_data, ctx->list + local_pointer, local_chunk_size * sizeof(int));
+    Int_sort(*sorted_data, local_chunk_size);
+    return NULL;
+  }
+  memcpy(local_data, ctx->list + local_pointer, local_chunk_size * sizeof(int));
+  *sorted_data = Sort_keys(ctx->local_kernel, local_data,
+      ctx->tmp_list + local_pointer, local_chunk_size, INT_MIN, INT_MAX);
+  return local_data;
+}  /* Sort_chunk */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Merge_samples
+ * Purpose:     Write this thread's slice of sorted_keys by merging the
+ *              per-thread sorted sample runs between two rank cuts, so
+ *              the whole team sorts the sample in O(S log S / p)
+ * In arg:      ctx, rank
+ */
+static void Merge_samples(sort_ctx *ctx, int rank) {
+  int thread_count = ctx->thread_count, i, j;
+  int local_sample_size = ctx->sample_size / thread_count;
+  size_t myindex, first = (size_t) rank * ctx->sample_size / thread_count;
+  size_t last = (size_t) (rank + 1) * ctx->sample_size / thread_count;
+  merge_run *runs = malloc(thread_count * sizeof(merge_run));
+  size_t *cuts = malloc(2 * thread_count * sizeof(size_t));
+
+  if (runs != NULL && cuts != NULL) {
+    for (i = 0; i < thread_count; i++) {
+      runs[i].cur = ctx->sample_keys + i * local_sample_size;
+      runs[i].end = runs[i].cur + local_sample_size;
+    }
+    Select_cuts(runs, thread_count, first, cuts);
+    Select_cuts(runs, thread_count, last, cuts + thread_count);
+    for (i = 0; i < thread_count; i++) {
+      runs[i].end = runs[i].cur + cuts[thread_count + i];
+      runs[i].cur += cuts[i];
+    }
+    if (Merge_runs(runs, thread_count, ctx->sorted_keys + first) == 0) {
+      free(runs);
+      free(cuts);
+      return;
+    }
+  }
+  free(runs);
+  free(cuts);
+
+  // Out of memory: rank every key by counting, keeping this slice
+  for (i = 0; i < ctx->sample_size; i++) {
+    int mykey = ctx->sample_keys[i];
+    myindex = 0;
+    for (j = 0; j < ctx->sample_size; j++) {
+      if (ctx->sample_keys[j] < mykey) {
+        myindex++;
+      } else if (ctx->sample_keys[j] == mykey && j < i) {
+        myindex++;
+      }
+    }
+    if (myindex >= first && myindex < last) {
+      ctx->sorted_keys[myindex] = mykey;
+    }
+  }
+}  /* Merge_samples */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Histogram_new
+ * Purpose:     Zeroed bucket counters for one thread's counting pass, on
+ *              cache lines of their own so the hot increments never share
+ *              a line with another thread's row of raw_dist
+ * In arg:      ctx, rank
+ * Return val:  The counters; this thread's row of raw_dist itself if they
+ *              could not be allocated
+ */
+static size_t *Histogram_new(sort_ctx *ctx, int rank) {
+  size_t bytes = ctx->bucket_count * sizeof(size_t);
+  size_t *hist;
+
+  bytes = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+  hist = aligned_alloc(CACHE_LINE, bytes);
+  if (hist == NULL) {
+    return ctx->raw_dist + (size_t) rank * ctx->bucket_count;
+  }
+  memset(hist, 0, bytes);
+  return hist;
+}  /* Histogram_new */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Histogram_publish
+ * Purpose:     Copy a thread's finished counters into its row of raw_dist
+ * In arg:      ctx, rank, hist (from Histogram_new, released here)
+ */
+static void Histogram_publish(sort_ctx *ctx, int rank, size_t *hist) {
+  size_t *row = ctx->raw_dist + (size_t) rank * ctx->bucket_count;
+
+  if (hist != row) {
+    memcpy(row, hist, ctx->bucket_count * sizeof(size_t));
+    free(hist);
+  }
+}  /* Histogram_publish */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Exact_split
+ * Purpose:     Fill this thread's columns of raw_dist by cutting every
+ *              sorted chunk at the exact ranks b*n/k and (b+1)*n/k
+ * In arg:      ctx, rank
+ * Note:        Select_cuts breaks ties between chunks in rank order, so
+ *              each chunk's slices stay contiguous and in bucket order,
+ *              as prefix_dist expects.
+ */
+static void Exact_split(sort_ctx *ctx, int rank) {
+  int thread_count = ctx->thread_count, bucket_count = ctx->bucket_count;
+  // Allocated up front: every rank must cut, or the columns disagree
+  merge_run *runs = ctx->cut_runs + (size_t) rank * thread_count;
+  size_t *cuts = ctx->cut_ranks + (size_t) rank * 2 * thread_count;
+  int bucket, i;
+
+  for (i = 0; i < thread_count; i++) {
+    runs[i].cur = ctx->sorted_runs[i];
+    runs[i].end = runs[i].cur + (Chunk_start(ctx, i + 1) - Chunk_start(ctx, i));
+  }
+  for (bucket = rank; bucket < bucket_count; bucket += thread_count) {
+    Select_cuts(runs, thread_count,
+        (size_t) bucket * ctx->list_size / bucket_count, cuts);
+    Select_cuts(runs, thread_count,
+        (size_t) (bucket + 1) * ctx->list_size / bucket_count, cuts + thread_count);
+    for (i = 0; i < thread_count; i++) {
+      ctx->raw_dist[i*bucket_count + bucket] = cuts[thread_count + i] - cuts[i];
+    }
+  }
+}  /* Exact_split */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Bucket_start
+ * Purpose:     First output index of a bucket (list_size for
+ *              bucket_count), once start_dist is scanned
+ * In arg:      ctx, bucket
+ */
+static size_t Bucket_start(const sort_ctx *ctx, int bucket) {
+  return ctx->start_dist[(size_t) bucket * ctx->thread_count];
+}  /* Bucket_start */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Stripe_start
+ * Purpose:     First list index of a thread's stripe under
+ *              PARTITION_INPLACE; stripes start on block boundaries and
+ *              the last one runs to the end of the list
+ * In arg:      ctx, rank
+ */
+static size_t Stripe_start(const sort_ctx *ctx, long rank) {
+  size_t blocks = ctx->list_size / INPLACE_BLOCK;
+
+  if (rank == ctx->thread_count) {
+    return ctx->list_size;
+  }
+  return (size_t) rank * blocks / ctx->thread_count * INPLACE_BLOCK;
+}  /* Stripe_start */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Classify_blocks
+ * Purpose:     Classify this thread's stripe into its buffer blocks,
+ *              flushing every full block back to the front of the stripe
+ * In arg:      ctx, tree, rank
+ * Note:        A block is flushed as soon as it holds INPLACE_BLOCK keys,
+ *              all of them already read, so the flush never overtakes
+ *              the keys still to be classified. Afterwards raw_dist holds
+ *              the thread's bucket sizes, each buffer the size modulo
+ *              INPLACE_BLOCK, and full_blocks the number of blocks flushed.
+ */
+static void Classify_blocks(sort_ctx *ctx, const classifier *tree, int rank) {
+  int bucket_count = ctx->bucket_count, b;
+  size_t begin = Stripe_start(ctx, rank), end = Stripe_start(ctx, rank + 1);
+  size_t *count = Histogram_new(ctx, rank);
+  int *buf = ctx->block_buf + (size_t) rank * bucket_count * INPLACE_BLOCK;
+  size_t r, w = begin, m, j, fill;
+  bucket_id bucket_of[INPLACE_BLOCK];
+
+  for (r = begin; r < end; r += m) {
+    m = end - r < INPLACE_BLOCK ? end - r : INPLACE_BLOCK;
+    Classify_batch(tree, ctx->list + r, m, bucket_of);
+    for (j = 0; j < m; j++) {
+      b = bucket_of[j];
+      fill = count[b]++ % INPLACE_BLOCK;
+      buf[(size_t) b * INPLACE_BLOCK + fill] = ctx->list[r + j];
+      if (fill == INPLACE_BLOCK - 1) {
+        memcpy(ctx->list + w, buf + (size_t) b * INPLACE_BLOCK,
+            INPLACE_BLOCK * sizeof(int));
+        w += INPLACE_BLOCK;
+      }
+    }
+  }
+  Histogram_publish(ctx, rank, count);
+  ctx->full_blocks[rank] = (w - begin) / INPLACE_BLOCK;
+}  /* Classify_blocks */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Nth_slot
+ * Purpose:     The m-th (from 0) empty slot below full, or the m-th full
+ *              slot at or above it, counting in slot order
+ * In arg:      ctx, m, full (total full blocks), want_full
+ */
+static size_t Nth_slot(const sort_ctx *ctx, size_t m, size_t full, int want_full) {
+  size_t first, last, lo, hi, n;
+  int i;
+
+  for (i = 0; i < ctx->thread_count; i++) {
+    first = Stripe_start(ctx, i) / INPLACE_BLOCK;
+    last = first + ctx->full_blocks[i];
+    if (want_full) {
+      lo = first > full ? first : full;
+      hi = last;
+    } else {
+      lo = last;
+      hi = Stripe_start(ctx, i + 1) / INPLACE_BLOCK;
+      hi = hi < full ? hi : full;
+    }
+    n = hi > lo ? hi - lo : 0;
+    if (m < n) {
+      return lo + m;
+    }
+    m -= n;
+  }
+  return 0;
+}  /* Nth_slot */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Compact_blocks
+ * Purpose:     Move the full blocks into the first full slots of the
+ *              list, the m-th one past that range into the m-th hole
+ *              before it, with the moves split evenly between threads
+ * In arg:      ctx, rank, full (total full blocks)
+ */
+static void Compact_blocks(sort_ctx *ctx, int rank, size_t full) {
+  size_t moves = 0, m, first, last, hi;
+  int i;
+
+  for (i = 0; i < ctx->thread_count; i++) {
+    first = Stripe_start(ctx, i) / INPLACE_BLOCK;
+    hi = first + ctx->full_blocks[i];
+    first = first > full ? first : full;
+    moves += hi > first ? hi - first : 0;
+  }
+  first = (size_t) rank * moves / ctx->thread_count;
+  last = (size_t) (rank + 1) * moves / ctx->thread_count;
+  for (m = first; m < last; m++) {
+    memcpy(ctx->list + Nth_slot(ctx, m, full, 0) * INPLACE_BLOCK,
+        ctx->list + Nth_slot(ctx, m, full, 1) * INPLACE_BLOCK,
+        INPLACE_BLOCK * sizeof(int));
+  }
+}  /* Compact_blocks */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Slot_block
+ * Purpose:     Where a slot's keys live: the list, or the overflow block
+ *              for the one slot that runs past the list's end
+ * In arg:      ctx, slot
+ */
+static int *Slot_block(sort_ctx *ctx, size_t slot) {
+  if ((slot + 1) * INPLACE_BLOCK > ctx->list_size) {
+    return ctx->overflow;
+  }
+  return ctx->list + slot * INPLACE_BLOCK;
+}  /* Slot_block */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Lock_slots / Unlock_slots
+ * Purpose:     Guard one bucket's slot pointers; held only for a pointer
+ *              update or, when reading, a single block copy
+ * In arg:      slots
+ */
+static void Lock_slots(bucket_slots *slots) {
+  unsigned polls = 0;
+
+  while (atomic_flag_test_and_set_explicit(&slots->lock, memory_order_acquire)) {
+    Spin_pause(&polls);
+  }
+}  /* Lock_slots */
+
+static void Unlock_slots(bucket_slots *slots) {
+  atomic_flag_clear_explicit(&slots->lock, memory_order_release);
+}  /* Unlock_slots */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Permute_blocks
+ * Purpose:     Move every full block into its bucket's region of slots
+ * In arg:      ctx, tree, rank
+ * Note:        Slots [write, read) of a bucket hold full blocks not yet
+ *              looked at. A thread takes the block at read - 1 and finds
+ *              its bucket; the destination's slot at write is claimed,
+ *              and if it still held an unread block that one is carried
+ *              on next, otherwise the chain ends. Claiming is exclusive,
+ *              and a slot being read is copied under its bucket's lock,
+ *              so no block is overwritten before it has been picked up.
+ */
+static void Permute_blocks(sort_ctx *ctx, const classifier *tree, int rank) {
+  int bucket_count = ctx->bucket_count, i, bucket, dest;
+  int *carry = ctx->swap_buf + (size_t) rank * 2 * INPLACE_BLOCK;
+  int *next = carry + INPLACE_BLOCK, *swap;
+  bucket_slots *slots;
+  size_t slot;
+  int full;
+
+  // Start at different buckets so threads rarely share a lock
+  for (i = 0; i < bucket_count; i++) {
+    bucket = (int) (((size_t) rank * bucket_count / ctx->thread_count + i) % bucket_count);
+    slots = &ctx->slots[bucket];
+    for (;;) {
+      Lock_slots(slots);
+      if (slots->read <= slots->write) {
+        Unlock_slots(slots);
+        break;
+      }
+      slots->read--;
+      memcpy(carry, ctx->list + slots->read * INPLACE_BLOCK, INPLACE_BLOCK * sizeof(int));
+      Unlock_slots(slots);
+
+      // Follow the chain of displaced blocks until one lands in a hole
+      do {
+        dest = Classify(tree, carry[0]);
+        Lock_slots(&ctx->slots[dest]);
+        slot = ctx->slots[dest].write++;
+        full = slot < ctx->slots[dest].read;
+        Unlock_slots(&ctx->slots[dest]);
+        if (full) {
+          memcpy(next, ctx->list + slot * INPLACE_BLOCK, INPLACE_BLOCK * sizeof(int));
+        }
+        memcpy(Slot_block(ctx, slot), carry, INPLACE_BLOCK * sizeof(int));
+        swap = carry;
+        carry = next;
+        next = swap;
+      } while (full);
+    }
+  }
+}  /* Permute_blocks */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Save_spill
+ * Purpose:     Set aside the keys of a bucket's last block that lie past
+ *              the bucket's end, and put the overflow block's keys that
+ *              belong inside the list there
+ * In arg:      ctx, bucket
+ * Note:        Bucket regions start on the block boundary at or after the
+ *              bucket's first index, so only the last block can overhang.
+ */
+static void Save_spill(sort_ctx *ctx, int bucket) {
+  bucket_slots *slots = &ctx->slots[bucket];
+  size_t first = (Bucket_start(ctx, bucket) + INPLACE_BLOCK - 1) / INPLACE_BLOCK;
+  size_t end = Bucket_start(ctx, bucket + 1), pos, j;
+  int *block, *spill = ctx->spill_buf + (size_t) bucket * INPLACE_BLOCK;
+
+  slots->spill = 0;
+  if (slots->write == first) {
+    return;
+  }
+  block = Slot_block(ctx, slots->write - 1);
+  for (j = 0; j < INPLACE_BLOCK; j++) {
+    pos = (slots->write - 1) * INPLACE_BLOCK + j;
+    if (pos >= end) {
+      spill[slots->spill++] = block[j];
+    } else if (block == ctx->overflow) {
+      ctx->list[pos] = block[j];
+    }
+  }
+}  /* Save_spill */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Fill_holes
+ * Purpose:     Complete a bucket from its spill and every thread's
+ *              partial buffer block
+ * In arg:      ctx, bucket
+ * Note:        The holes are the stretch before the bucket's first slot
+ *              and the one after its last full block, both cut at the
+ *              bucket's end; their old contents were saved by Save_spill.
+ */
+static void Fill_holes(sort_ctx *ctx, int bucket) {
+  int bucket_count = ctx->bucket_count, i;
+  size_t begin = Bucket_start(ctx, bucket), end = Bucket_start(ctx, bucket + 1);
+  size_t head_end = (begin + INPLACE_BLOCK - 1) / INPLACE_BLOCK * INPLACE_BLOCK;
+  size_t tail = ctx->slots[bucket].write * INPLACE_BLOCK;
+  size_t pos = begin, j, count;
+  const int *src;
+
+  head_end = head_end < end ? head_end : end;
+  tail = tail < end ? tail : end;
+  tail = tail > head_end ? tail : head_end;
+  for (i = -1; i < ctx->thread_count; i++) {
+    if (i < 0) {
+      src = ctx->spill_buf + (size_t) bucket * INPLACE_BLOCK;
+      count = ctx->slots[bucket].spill;
+    } else {
+      src = ctx->block_buf + ((size_t) i * bucket_count + bucket) * INPLACE_BLOCK;
+      count = ctx->raw_dist[(size_t) i * bucket_count + bucket] % INPLACE_BLOCK;
+    }
+    for (j = 0; j < count; j++) {
+      if (pos == head_end) {
+        pos = tail;
+      }
+      ctx->list[pos++] = src[j];
+    }
+  }
+}  /* Fill_holes */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    In_place_phases
+ * Purpose:     One thread's share of the in-place distribution, after
+ *              Classify_blocks and the bucket sizes: compact the full
+ *              blocks, permute them into their buckets and fill in the
+ *              partial blocks, leaving every bucket at its output range
+ * In arg:      ctx, tree, my_rank
+ */
+static void In_place_phases(sort_ctx *ctx, const classifier *tree, long my_rank) {
+  int bucket_count = ctx->bucket_count, thread_count = ctx->thread_count;
+  int i, bucket;
+  size_t full = 0, first, last;
+
+  for (i = 0; i < thread_count; i++) {
+    full += ctx->full_blocks[i];
+  }
+  // Each bucket's region starts at the first slot boundary in its range;
+  // after compaction its slots below full hold the unread blocks
+  for (bucket = my_rank; bucket < bucket_count; bucket += thread_count) {
+    first = (Bucket_start(ctx, bucket) + INPLACE_BLOCK - 1) / INPLACE_BLOCK;
+    last = (Bucket_start(ctx, bucket + 1) + INPLACE_BLOCK - 1) / INPLACE_BLOCK;
+    last = last < full ? last : full;
+    ctx->slots[bucket].write = first;
+    ctx->slots[bucket].read = last > first ? last : first;
+    atomic_flag_clear(&ctx->slots[bucket].lock);
+  }
+  Compact_blocks(ctx, my_rank, full);
+  Barrier_wait(ctx->barrier, my_rank);
+
+  Permute_blocks(ctx, tree, my_rank);
+  Barrier_wait(ctx->barrier, my_rank);
+
+  for (bucket = my_rank; bucket < bucket_count; bucket += thread_count) {
+    Save_spill(ctx, bucket);
+  }
+  Barrier_wait(ctx->barrier, my_rank);
+
+  for (bucket = my_rank; bucket < bucket_count; bucket += thread_count) {
+    Fill_holes(ctx, bucket);
+  }
+  Barrier_wait(ctx->barrier, my_rank);
+}  /* In_place_phases */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Split_sort
+ * Purpose:     Sort a[0..n) with introsort, pushing the right side of
+ *              each partition as a stealable task while it is large
+ * In arg:      ctx, rank, n, depth
+ * In/out arg:  a
+ */
+static void Split_sort(sort_ctx *ctx, int rank, int *a, size_t n, int depth) {
+  size_t left_n, right_start;
+  sort_task *task;
+
+  while (n > STEAL_SPLIT && depth-- > 0) {
+    Int_sort_partition(a, n, &left_n, &right_start);
+    task = malloc(sizeof(sort_task));
+    if (task == NULL) {
+      break;
+    }
+    task->bucket = -1;
+    task->depth = depth;
+    task->base = a + right_start;
+    task->n = n - right_start;
+    atomic_fetch_add(&ctx->tasks_left, 1);
+    if (Deque_push(&ctx->deques[rank], task) != 0) {
+      atomic_fetch_sub(&ctx->tasks_left, 1);
+      free(task);
+      Int_sort(a + right_start, n - right_start);
+    }
+    n = left_n;
+  }
+  Int_sort(a, n);
+}  /* Split_sort */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Sort_bucket
+ * Purpose:     Gather one bucket's slices from the sorted chunks (or its
+ *              scattered copy in tmp_list) and sort or merge them into
+ *              the bucket's range of the output
+ * In arg:      ctx, bucket, rank
+ */
+static void Sort_bucket(sort_ctx *ctx, int bucket, int rank) {
+  int thread_count = ctx->thread_count, bucket_count = ctx->bucket_count;
+  size_t b_index;
+  int i;
+
+  // Sorted chunks hand each bucket one run per thread; classified
+  // chunks were scattered to the bucket's own stretch of tmp_list, and
+  // in place the blocks already put the bucket in its output range
+  int runs_sorted = ctx->partition == PARTITION_SORTED ||
+      ctx->partition == PARTITION_EXACT;
+  merge_run *runs;
+  size_t my_first_D = ctx->col_dist[bucket];
+  int *my_out = ctx->sorted_list + Bucket_start(ctx, bucket);
+
+  // Every key of this bucket lies in [splitters[bucket], splitters[bucket+1]);
+  // sorted slices narrow that to the exact range through their ends,
+  // unsorted ones leave it to Sort_keys to measure
+  int bucket_lo = runs_sorted ? INT_MAX : INT_MIN;
+  int bucket_hi = runs_sorted ? INT_MIN : INT_MAX;
+
+  int equal = ctx->equal_bucket[bucket];
+  int oversized = !equal && my_first_D > ctx->nested_threshold &&
+      ctx->depth < MAX_NEST_DEPTH;
+
+  if (runs_sorted) {
+    // Without the run list there is no merge; the runs are gathered
+    // into the output range as they are found and sorted there
+    runs = malloc(thread_count * sizeof(merge_run));
+
+    // For each thread in the column...
+    b_index = 0;
+    for (i = 0; i < thread_count; i++) {
+      size_t row_offset = 0;
+      size_t count = ctx->raw_dist[i*bucket_count + bucket];
+      const int *run;
+
+      if (bucket != 0) {
+        row_offset = ctx->prefix_dist[i*bucket_count + bucket-1];
+      }
+      run = ctx->sorted_runs[i] + row_offset;
+      if (runs != NULL) {
+        runs[i].cur = run;
+        runs[i].end = run + count;
+      } else {
+        memcpy(my_out + b_index, run, count * sizeof(int));
+        b_index += count;
+      }
+      if (count != 0) {
+        bucket_lo = run[0] < bucket_lo ? run[0] : bucket_lo;
+        bucket_hi = run[count - 1] > bucket_hi ? run[count - 1] : bucket_hi;
+      }
+    }
+
+    // Every chunk was copied out of the list before any bucket starts,
+    // so the output range may be written right away
+    if (runs != NULL && ctx->bucket_kernel == SORT_MERGE && !oversized &&
+        !equal && Merge_runs(runs, thread_count, my_out) == 0) {
+      free(runs);
+      return;
+    }
+
+    // Gather the bucket straight into its output range
+    if (runs != NULL) {
+      for (i = 0; i < thread_count; i++) {
+        memcpy(my_out + b_index, runs[i].cur, (runs[i].end - runs[i].cur) * sizeof(int));
+        b_index += runs[i].end - runs[i].cur;
+      }
+      free(runs);
+    }
+  } else if (ctx->partition == PARTITION_CLASSIFY) {
+    int *src = ctx->tmp_list + Bucket_start(ctx, bucket);
+
+    // The radix kernels ping-pong between the scattered copy and the
+    // output range, so the bucket moves only when they finish on the copy
+    if (!equal && !oversized &&
+        (ctx->bucket_kernel == SORT_RADIX || ctx->bucket_kernel == SORT_RANGE)) {
+      int *sorted_D = Sort_keys(ctx->bucket_kernel, src, my_out, my_first_D,
+          bucket_lo, bucket_hi);
+
+      if (sorted_D != my_out) {
+        memcpy(my_out, sorted_D, my_first_D * sizeof(int));
+      }
+      return;
+    }
+    memcpy(my_out, src, my_first_D * sizeof(int));
+  }
+
+  // A bucket of one repeated key is sorted as soon as it is gathered
+  if (equal || (runs_sorted && bucket_lo == bucket_hi)) {
+    return;
+  }
+  // Too big for one thread: leave it for the whole team once every
+  // ordinary bucket is done
+  if (oversized) {
+    ctx->big_buckets[atomic_fetch_add(&ctx->big_count, 1)] = bucket;
+    return;
+  }
+
+  // Sort local bucket
+  if (ctx->bucket_kernel == SORT_RADIX || ctx->bucket_kernel == SORT_RANGE) {
+    // The bucket's own stretch of tmp_list is free scratch unless other
+    // buckets are still being gathered from sorted chunks kept there
+    int *scratch, *owned = NULL, *sorted_D;
+
+    if (ctx->tmp_list != NULL &&
+        !atomic_load_explicit(&ctx->runs_in_tmp, memory_order_relaxed)) {
+      scratch = ctx->tmp_list + Bucket_start(ctx, bucket);
+    } else {
+      scratch = owned = malloc(my_first_D * sizeof(int));
+    }
+    if (scratch == NULL) {
+      Int_sort(my_out, my_first_D);
+      return;
+    }
+    sorted_D = Sort_keys(ctx->bucket_kernel, my_out, scratch, my_first_D,
+        bucket_lo, bucket_hi);
+    if (sorted_D != my_out) {
+      memcpy(my_out, sorted_D, my_first_D * sizeof(int));
+    }
+    free(owned);
+  } else if (ctx->schedule == SCHEDULE_STEAL) {
+    // Same 2*log2(n) partition budget as a serial introsort
+    int depth = 0;
+    size_t m;
+
+    for (m = my_first_D; m > 1; m >>= 1) {
+      depth += 2;
+    }
+    Split_sort(ctx, rank, my_out, my_first_D, depth);
+  } else {
+    Int_sort(my_out, my_first_D);
+  }
+}  /* Sort_bucket */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Steal_work
+ * Purpose:     Run tasks from this thread's deque, stealing from random
+ *              victims when it runs dry, until no task is left anywhere
+ * In arg:      ctx, rank
+ */
+static void Steal_work(sort_ctx *ctx, int rank) {
+  ws_deque *mine = &ctx->deques[rank];
+  rng victims;
+  unsigned misses = 0;
+  int victim;
+  double start, finish;
+  sort_task *task;
+
+  // Victim streams count down from the top, clear of the sampling ones
+  Rng_seed(&victims, ctx->opts.seed, UINT64_MAX - rank);
+  for (;;) {
+    task = Deque_pop(mine);
+    if (task == NULL) {
+      if (atomic_load(&ctx->tasks_left) == 0) {
+        break;
+      }
+      victim = (int) Rng_below(&victims, ctx->thread_count);
+      task = victim == rank ? NULL : Deque_steal(&ctx->deques[victim]);
+      if (task == NULL) {
+        Spin_pause(&misses);
+        continue;
+      }
+    }
+
+    GET_TIME(start);
+    if (task->bucket >= 0) {
+      Sort_bucket(ctx, task->bucket, rank);
+    } else {
+      Split_sort(ctx, rank, task->base, task->n, task->depth);
+      free(task);
+    }
+    GET_TIME(finish);
+    ctx->times[rank].busy += finish - start;
+    atomic_fetch_sub(&ctx->tasks_left, 1);
+  }
+}  /* Steal_work */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Nested_sort
+ * Purpose:     Sample sort one oversized bucket, already gathered into
+ *              its output range, with every thread of the team; called by
+ *              all ranks together
+ * In arg:      ctx, bucket, my_rank
+ */
+static void Nested_sort(sort_ctx *ctx, int bucket, long my_rank) {
+  size_t start = Bucket_start(ctx, bucket);
+  size_t size = ctx->col_dist[bucket];
+
+  // tmp_list is no longer read once the buckets are gathered, so the
+  // bucket's own stretch of it serves as the nested scratch list (an
+  // in-place sort has none and needs none)
+  if (my_rank == 0) {
+    ctx->nested = malloc(sizeof(sort_ctx));
+    ctx->nested_ok = ctx->nested != NULL &&
+        Ctx_init(ctx->nested, ctx->sorted_list + start, size, &ctx->opts,
+            ctx->tmp_list != NULL ? ctx->tmp_list + start : NULL,
+            ctx->depth + 1) == 0;
+    if (ctx->nested_ok) {
+      ctx->nested->barrier = ctx->barrier;
+    }
+  }
+  Barrier_wait(ctx->barrier, my_rank);
+
+  if (ctx->nested_ok) {
+    Sort_phases(ctx->nested, my_rank);
+  } else if (my_rank == 0) {
+    Int_sort(ctx->sorted_list + start, size);
+  }
+
+  // Nobody may still be inside the nested context when it is freed
+  Barrier_wait(ctx->barrier, my_rank);
+  if (my_rank == 0) {
+    if (ctx->nested_ok) {
+      Ctx_free(ctx->nested);
+    }
+    free(ctx->nested);
+    ctx->nested = NULL;
+  }
+}  /* Nested_sort */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Sort_phases
+ * Purpose:     Run one thread's share of every sample sort phase
+ * In arg:      ctx, my_rank
+ */
+static void Sort_phases(sort_ctx *ctx, long my_rank) {
+  int thread_count = ctx->thread_count, bucket_count = ctx->bucket_count;
+  int i, offset, local_sample_size;
+  int s_index, my_segment, bucket;
+  size_t k, seed, local_pointer, local_chunk_size, col_sum;
+  int *local_data, *sorted_data = NULL;
+  bucket_id *bucket_of = NULL;
+  classifier tree;
+  size_t *hist;
+
+  local_pointer = Chunk_start(ctx, my_rank);
+  local_chunk_size = Chunk_start(ctx, my_rank + 1) - local_pointer;
+  local_sample_size = ctx->sample_size / thread_count;
+
+  offset = my_rank * local_sample_size;
+  local_data = NULL;
+
+  // Exact cuts need no splitters
+  if (ctx->partition != PARTITION_EXACT) {
+    if (ctx->sampling == SAMPLE_REGULAR) {
+      // Regular sampling (PSRS): sort the chunk first, then evenly spaced
+      // positions are evenly spaced ranks
+      local_data = Sort_chunk(ctx, local_pointer, local_chunk_size, &sorted_data);
+      for (i = 0; i < local_sample_size; i++) {
+        ctx->sample_keys[offset + i] =
+            sorted_data[(size_t) i * local_chunk_size / local_sample_size];
+      }
+    } else {
+      // Get sample keys randomly from original list, each thread (and
+      // each nesting level) drawing from its own stream. Positions are
+      // drawn with replacement: a repeated key only repeats a splitter
+      // candidate, which the sort tolerates like any duplicate key
+      rng stream;
+
+      Rng_seed(&stream, ctx->opts.seed, (uint64_t) ctx->depth << 32 | my_rank);
+      for (i = offset; i < (offset + local_sample_size); i++) {
+        seed = local_pointer + Rng_below(&stream, local_chunk_size);
+        ctx->sample_keys[i] = ctx->list[seed];
+      }
+      Int_sort(ctx->sample_keys + offset, local_sample_size);
+    }
+    Dep_post(&ctx->deps.samples);
+
+    // The sorted-chunk partition sorts its chunk while the other threads
+    // are still drawing samples, instead of after the splitters
+    if (ctx->partition == PARTITION_SORTED && sorted_data == NULL) {
+      local_data = Sort_chunk(ctx, local_pointer, local_chunk_size, &sorted_data);
+    }
+
+    // Each thread merges one slice of the sorted sample
+    Dep_wait(&ctx->deps.samples, thread_count);
+    Merge_samples(ctx, my_rank);
+    Dep_post(&ctx->deps.slices[my_rank]);
+
+    // Every bucket boundary past the first gets a splitter, dealt out
+    // round-robin, as soon as the slices around it are merged;
+    // splitters[0] should always be zero
+    for (bucket = my_rank; bucket < bucket_count; bucket += thread_count) {
+      Wait_slices(ctx, bucket);
+      if (bucket != 0) {
+        ctx->splitters[bucket] = Splitter_at(ctx, bucket);
+      }
+      ctx->equal_bucket[bucket] = Is_equal_bucket(ctx, bucket);
+    }
+    Dep_post(&ctx->deps.splitters);
+
+    // Classifying or counting a chunk needs every splitter
+    Dep_wait(&ctx->deps.splitters, thread_count);
+    if (ctx->partition == PARTITION_CLASSIFY ||
+        ctx->partition == PARTITION_INPLACE) {
+      Classifier_lay_out(&tree, ctx->class_trees +
+          (size_t) my_rank * Classifier_size(bucket_count),
+          ctx->splitters + 1, bucket_count);
+    }
+  }
+
+  // starting point of this thread's segment in dist arrays
+  my_segment = my_rank * bucket_count;
+
+  if (ctx->partition == PARTITION_CLASSIFY) {
+    // Classify the unsorted chunk, remembering each key's bucket for the
+    // scatter into tmp_list once the bucket sizes are known
+    bucket_of = ctx->bucket_of + local_pointer;
+    Classify_batch(&tree, ctx->list + local_pointer, local_chunk_size, bucket_of);
+    hist = Histogram_new(ctx, my_rank);
+    for (k = 0; k < local_chunk_size; k++) {
+      hist[bucket_of[k]]++;
+    }
+    Histogram_publish(ctx, my_rank, hist);
+  } else if (ctx->partition == PARTITION_INPLACE) {
+    Classify_blocks(ctx, &tree, my_rank);
+  } else {
+    // Exact cuts sort the chunk here, regular sampling already did
+    if (sorted_data == NULL) {
+      local_data = Sort_chunk(ctx, local_pointer, local_chunk_size, &sorted_data);
+    }
+
+    // The buckets are gathered straight from every thread's sorted chunk
+    ctx->sorted_runs[my_rank] = sorted_data;
+    if (sorted_data != local_data) {
+      atomic_store_explicit(&ctx->runs_in_tmp, 1, memory_order_relaxed);
+    }
+    if (ctx->partition == PARTITION_EXACT) {
+      // Every thread's sorted chunk must be visible before any is cut,
+      // and every column of this thread's row cut before it is summed
+      Dep_post(&ctx->deps.runs);
+      Dep_wait(&ctx->deps.runs, thread_count);
+      Exact_split(ctx, my_rank);
+      Dep_post(&ctx->deps.cut);
+      Dep_wait(&ctx->deps.cut, thread_count);
+    } else {
+      // index in the splitter array
+      s_index = 1;
+      hist = Histogram_new(ctx, my_rank);
+
+      // Generate the original distribution array, loop through each local entry
+      for (k = 0; k < local_chunk_size; k++) {
+        // Elem is out of bucket's range, time to increase splitter
+        // Keep increasing until you find one that fits
+        // Also make sure if equals we still increment
+        while (s_index < bucket_count && sorted_data[k] >= ctx->splitters[s_index]) {
+          s_index++;
+        }
+        // Add to the raw distribution array, -1 because splitter[0] = 0
+        hist[s_index-1]++;
+      }
+      Histogram_publish(ctx, my_rank, hist);
+    }
+  }
+
+  // Generate prefix sum distribution array
+  // For the specific section that this thread is in charge of...
+  for (i = my_segment; i < (my_segment + bucket_count); i++) {
+    if (i == my_segment) {
+      ctx->prefix_dist[i] = ctx->raw_dist[i];
+    } else {
+      ctx->prefix_dist[i] = ctx->raw_dist[i] + ctx->prefix_dist[i - 1];
+    }
+  }
+  Dep_post(&ctx->deps.rows);
+
+  // Generate column sum distribution, columns dealt out round-robin;
+  // a column reads one entry of every row, and is also laid out
+  // bucket-major in start_dist for the scan
+  Dep_wait(&ctx->deps.rows, thread_count);
+  for (bucket = my_rank; bucket < bucket_count; bucket += thread_count) {
+    col_sum = 0;
+    for (i = 0; i < thread_count; i++) {
+      col_sum += ctx->raw_dist[bucket + i * bucket_count];
+      ctx->start_dist[(size_t) bucket * thread_count + i] =
+          ctx->raw_dist[bucket + i * bucket_count];
+    }
+    ctx->col_dist[bucket] = col_sum;
+  }
+  Dep_post(&ctx->deps.cols);
+  Dep_wait(&ctx->deps.cols, thread_count);
+
+  // One exclusive scan of start_dist gives every bucket's start and
+  // every thread's place within each bucket
+  Scan_run(&ctx->start_scan, ctx->start_dist, ctx->start_dist,
+      (size_t) thread_count * bucket_count, my_rank);
+  Dep_post(&ctx->deps.starts);
+
+  if (my_rank == 0) {
+    // Hand buckets out largest first, so a big one never starts last
+    for (i = 0; i < bucket_count; i++) {
+      ctx->bucket_order[i].size = ctx->col_dist[i];
+      ctx->bucket_order[i].bucket = i;
+    }
+    Order_sort(ctx->bucket_order, bucket_count);
+    Dep_post(&ctx->deps.order);
+  }
+  Dep_wait(&ctx->deps.starts, thread_count);
+
+  if (ctx->partition == PARTITION_CLASSIFY) {
+    // Scatter the chunk straight to each key's final index, in tmp_list
+    // since the list is still being read: the bucket's start plus the
+    // keys earlier threads send to the same bucket. This only needs
+    // start_dist, so it runs while rank 0 orders the buckets
+    size_t *next = ctx->scatter_next + my_segment;
+    wc_buffers wc;
+
+    for (i = 0; i < bucket_count; i++) {
+      next[i] = ctx->start_dist[(size_t) i * thread_count + my_rank];
+    }
+
+    if (ctx->scatter == SCATTER_STREAM &&
+        Wc_init(&wc, ctx->tmp_list, next, bucket_count) == 0) {
+      for (k = 0; k < local_chunk_size; k++) {
+        Wc_put(&wc, bucket_of[k], ctx->list[local_pointer + k]);
+      }
+      Wc_flush(&wc);
+      Wc_free(&wc);
+    } else {
+      for (k = 0; k < local_chunk_size; k++) {
+        ctx->tmp_list[next[bucket_of[k]]++] = ctx->list[local_pointer + k];
+      }
+    }
+
+    // Any bucket may hold keys of any chunk, and its output range is
+    // still being read by the scatter
+    Dep_post(&ctx->deps.scattered);
+    Dep_wait(&ctx->deps.scattered, thread_count);
+  }
+
+  // The bucket phase also needs the queue order; every
+  // chunk was copied or scattered out of the list before its row was
+  // posted, so the output may be written from here on
+  Dep_wait(&ctx->deps.order, 1);
+
+  if (ctx->partition == PARTITION_INPLACE) {
+    In_place_phases(ctx, &tree, my_rank);
+  }
+
+  GET_TIME(ctx->times[my_rank].start);
+  if (ctx->schedule == SCHEDULE_STEAL) {
+    // Seed this thread's deque with every thread_count-th bucket of the
+    // queue order, smallest first so the owner pops its largest first
+    for (i = bucket_count - 1; i >= 0; i--) {
+      if (i % thread_count == my_rank) {
+        Deque_push(&ctx->deques[my_rank], &ctx->bucket_tasks[ctx->bucket_order[i].bucket]);
+      }
+    }
+    Steal_work(ctx, my_rank);
+  } else {
+    // Pull buckets off the shared queue until it runs dry
+    double start, finish;
+
+    while ((i = atomic_fetch_add(&ctx->next_bucket, 1)) < bucket_count) {
+      GET_TIME(start);
+      Sort_bucket(ctx, ctx->bucket_order[i].bucket, my_rank);
+      GET_TIME(finish);
+      ctx->times[my_rank].busy += finish - start;
+    }
+  }
+
+  // Oversized buckets were only gathered; sort them one at a time with
+  // the whole team, counting that as busy time for everyone
+  Barrier_wait(ctx->barrier, my_rank);
+  free(local_data);
+  if (atomic_load(&ctx->big_count) > 0) {
+    double start, finish;
+
+    GET_TIME(start);
+    for (i = 0; i < atomic_load(&ctx->big_count); i++) {
+      Nested_sort(ctx, ctx->big_buckets[i], my_rank);
+    }
+    GET_TIME(finish);
+    ctx->times[my_rank].busy += finish - start;
+  }
+  GET_TIME(ctx->times[my_rank].end);
+}  /* Sort_phases */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Thread_work
+ * Purpose:     Run one thread's share of every sample sort phase
+ * In arg:      arg (thread_arg with the shared context and the rank)
+ * Return val:  Ignored
+ */
+static void *Thread_work(void *arg) {
+  sort_ctx *ctx = ((thread_arg *) arg)->ctx;
+
+  // No thread starts until all of them exist, since a missing rank
+  // would leave the others waiting on it forever
+  Dep_wait(&ctx->deps.launched, 1);
+  if (!ctx->launch_failed) {
+    Sort_phases(ctx, ((thread_arg *) arg)->rank);
+  }
+  return NULL;
+}  /* Thread_work */
+
+
+
+/*-------------------------------------------------------------------
+ * Function:    Pool_work
+ * Purpose:     Adapt Sort_phases to the thread pool task signature
+ * In arg:      ctx, rank
+ */
+static void Pool_work(void *ctx, int rank) {
+  // The pool's workers already exist, so there is no launch to wait for
+  Sort_phases(ctx, rank);
+}  /* Pool_work */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Ctx_free
+ * Purpose:     Release every buffer owned by a sort context
+ * In arg:      ctx
+ */
+static void Ctx_free(sort_ctx *ctx) {
+  if (ctx->owns_tmp) {
+    free(ctx->tmp_list);
+  }
+  free(ctx->big_buckets);
+  free(ctx->sample_keys);
+  free(ctx->sorted_keys);
+  free(ctx->splitters);
+  free(ctx->equal_bucket);
+  free(ctx->sorted_runs);
+  free(ctx->cut_runs);
+  free(ctx->cut_ranks);
+  free(ctx->block_buf);
+  free(ctx->swap_buf);
+  free(ctx->spill_buf);
+  free(ctx->overflow);
+  free(ctx->full_blocks);
+  free(ctx->slots);
+  free(ctx->class_trees);
+  free(ctx->bucket_of);
+  free(ctx->scatter_next);
+  free(ctx->raw_dist);
+  free(ctx->prefix_dist);
+  free(ctx->col_dist);
+  free(ctx->start_dist);
+  Scan_free(&ctx->start_scan);
+  free(ctx->bucket_order);
+  free(ctx->bucket_tasks);
+  free(ctx->times);
+  free(ctx->deps.slices);
+  if (ctx->deques != NULL) {
+    int i;
+
+    for (i = 0; i < ctx->thread_count; i++) {
+      Deque_free(&ctx->deques[i]);
+    }
+    free(ctx->deques);
+  }
+}  /* Ctx_free */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Ctx_init
+ * Purpose:     Size and allocate a sort context for one call
+ * In arg:      data, n, opts, scratch (n ints to use as tmp_list, or
+ *              NULL to allocate them), depth (of nesting)
+ * Out arg:     ctx
+ * Return val:  0 on success, -1 with errno set on failure
+ */
+static int Ctx_init(sort_ctx *ctx, int *data, size_t n, const sort_opts *opts,
+    int *scratch, int depth) {
+  int thread_count = opts->thread_count;
+  int bucket_count = opts->bucket_count;
+  int local_sample_size, i;
+  size_t pk;
+
+  if (opts->pool != NULL && thread_count > Pool_size(opts->pool)) {
+    thread_count = Pool_size(opts->pool);
+  }
+  if (thread_count < 1 || opts->sample_size < 0 || bucket_count < 0 ||
+      ((opts->partition == PARTITION_CLASSIFY || opts->partition == PARTITION_INPLACE) &&
+       bucket_count > MAX_BUCKETS)) {
+    errno = EINVAL;
+    return -1;
+  }
+  // Every thread needs at least one element to draw samples from
+  if ((size_t) thread_count > n) {
+    thread_count = (int) n;
+  }
+  if (bucket_count == 0) {
+    bucket_count = thread_count;
+  }
+  // Each splitter is picked from its own stretch of the sorted samples
+  local_sample_size = opts->sample_size / thread_count;
+  if (local_sample_size * thread_count < bucket_count) {
+    local_sample_size = (bucket_count + thread_count - 1) / thread_count;
+  }
+
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->list = ctx->sorted_list = data;
+  ctx->list_size = n;
+  ctx->thread_count = thread_count;
+  ctx->bucket_count = bucket_count;
+  ctx->sample_size = local_sample_size * thread_count;
+  ctx->local_kernel = opts->local_kernel;
+  ctx->bucket_kernel = opts->bucket_kernel;
+  ctx->partition = opts->partition;
+  ctx->sampling = opts->sampling;
+  // Regular samples come from sorted chunks, so there is nothing left
+  // for the classifier to save
+  if (ctx->sampling == SAMPLE_REGULAR && ctx->partition == PARTITION_CLASSIFY) {
+    ctx->partition = PARTITION_SORTED;
+  }
+  // Regular sampling and the radix kernels would need list-sized scratch
+  if (ctx->partition == PARTITION_INPLACE) {
+    ctx->sampling = SAMPLE_RANDOM;
+    ctx->bucket_kernel = SORT_INTRO;
+  }
+  ctx->schedule = opts->schedule;
+  ctx->scatter = opts->scatter;
+  ctx->depth = depth;
+  ctx->nested_threshold = opts->nested_threshold;
+  if (ctx->nested_threshold == 0) {
+    ctx->nested_threshold = 2 * (n / thread_count);
+    if (ctx->nested_threshold < NESTED_MIN) {
+      ctx->nested_threshold = NESTED_MIN;
+    }
+  }
+  // A nested sort must give every thread of the team at least one key
+  if (ctx->nested_threshold < (size_t) thread_count) {
+    ctx->nested_threshold = thread_count;
+  }
+  // Nested sorts run on the same team with the same choices
+  ctx->opts = *opts;
+  ctx->opts.thread_count = thread_count;
+  ctx->opts.bucket_count = bucket_count;
+  ctx->opts.sample_size = local_sample_size * thread_count;
+  ctx->opts.pool = NULL;
+  ctx->opts.stats = NULL;
+  atomic_init(&ctx->big_count, 0);
+  atomic_init(&ctx->runs_in_tmp, 0);
+  atomic_init(&ctx->next_bucket, 0);
+  atomic_init(&ctx->tasks_left, bucket_count);
+  atomic_init(&ctx->deps.samples, 0);
+  atomic_init(&ctx->deps.splitters, 0);
+  atomic_init(&ctx->deps.runs, 0);
+  atomic_init(&ctx->deps.cut, 0);
+  atomic_init(&ctx->deps.rows, 0);
+  atomic_init(&ctx->deps.cols, 0);
+  atomic_init(&ctx->deps.starts, 0);
+  atomic_init(&ctx->deps.order, 0);
+  atomic_init(&ctx->deps.scattered, 0);
+  atomic_init(&ctx->deps.launched, 0);
+  pk = (size_t) thread_count * bucket_count;
+
+  if (ctx->partition == PARTITION_INPLACE) {
+    ctx->owns_tmp = 0;
+    ctx->block_buf = malloc(pk * INPLACE_BLOCK * sizeof(int));
+    ctx->swap_buf = malloc((size_t) thread_count * 2 * INPLACE_BLOCK * sizeof(int));
+    ctx->spill_buf = malloc((size_t) bucket_count * INPLACE_BLOCK * sizeof(int));
+    ctx->overflow = malloc(INPLACE_BLOCK * sizeof(int));
+    ctx->full_blocks = malloc(thread_count * sizeof(size_t));
+    ctx->slots = malloc(bucket_count * sizeof(bucket_slots));
+    if (!ctx->block_buf || !ctx->swap_buf || !ctx->spill_buf || !ctx->overflow ||
+        !ctx->full_blocks || !ctx->slots) {
+      Ctx_free(ctx);
+      errno = ENOMEM;
+      return -1;
+    }
+  } else {
+    ctx->owns_tmp = scratch == NULL;
+    ctx->tmp_list = scratch != NULL ? scratch : malloc(n * sizeof(int));
+    if (!ctx->tmp_list) {
+      Ctx_free(ctx);
+      errno = ENOMEM;
+      return -1;
+    }
+  }
+  ctx->big_buckets = malloc(bucket_count * sizeof(int));
+  ctx->sample_keys = malloc(ctx->sample_size * sizeof(int));
+  ctx->sorted_keys = malloc(ctx->sample_size * sizeof(int));
+  ctx->splitters = calloc(bucket_count, sizeof(int));
+  ctx->equal_bucket = calloc(bucket_count, 1);
+  ctx->sorted_runs = malloc(thread_count * sizeof(int *));
+  ctx->bucket_order = malloc(bucket_count * sizeof(bucket_ref));
+  ctx->times = calloc(thread_count, sizeof(phase_time));
+  ctx->deps.slices = malloc(thread_count * sizeof(atomic_int));
+
+  // One dimensional distribution arrays, thread_count rows of bucket_count
+  ctx->raw_dist = calloc(pk, sizeof(size_t));
+  ctx->prefix_dist = malloc(pk * sizeof(size_t));
+  ctx->col_dist = malloc(bucket_count * sizeof(size_t));
+  ctx->start_dist = malloc((pk + 1) * sizeof(size_t));
+
+  if (!ctx->big_buckets || !ctx->sample_keys || !ctx->sorted_keys ||
+      !ctx->splitters || !ctx->equal_bucket || !ctx->sorted_runs ||
+      !ctx->bucket_order || !ctx->raw_dist ||
+      !ctx->prefix_dist || !ctx->col_dist || !ctx->start_dist ||
+      !ctx->times || !ctx->deps.slices ||
+      Scan_init(&ctx->start_scan, pk, thread_count) != 0) {
+    Ctx_free(ctx);
+    errno = ENOMEM;
+    return -1;
+  }
+  for (i = 0; i < thread_count; i++) {
+    atomic_init(&ctx->deps.slices[i], 0);
+  }
+
+  // Every thread's classifier and scatter state is allocated here, so
+  // that running out of memory fails the call before any key moves
+  if (ctx->partition == PARTITION_CLASSIFY ||
+      ctx->partition == PARTITION_INPLACE) {
+    ctx->class_trees = malloc(thread_count * Classifier_size(bucket_count) * sizeof(int));
+    if (!ctx->class_trees) {
+      Ctx_free(ctx);
+      errno = ENOMEM;
+      return -1;
+    }
+  }
+  if (ctx->partition == PARTITION_CLASSIFY) {
+    ctx->bucket_of = malloc(n * sizeof(bucket_id));
+    ctx->scatter_next = malloc(pk * sizeof(size_t));
+    if (!ctx->bucket_of || !ctx->scatter_next) {
+      Ctx_free(ctx);
+      errno = ENOMEM;
+      return -1;
+    }
+  }
+  if (ctx->partition == PARTITION_EXACT) {
+    ctx->cut_runs = malloc((size_t) thread_count * thread_count * sizeof(merge_run));
+    ctx->cut_ranks = malloc((size_t) thread_count * 2 * thread_count * sizeof(size_t));
+    if (!ctx->cut_runs || !ctx->cut_ranks) {
+      Ctx_free(ctx);
+      errno = ENOMEM;
+      return -1;
+    }
+  }
+
+  if (ctx->schedule == SCHEDULE_STEAL) {
+    ctx->bucket_tasks = malloc(bucket_count * sizeof(sort_task));
+    ctx->deques = calloc(thread_count, sizeof(ws_deque));
+    if (!ctx->bucket_tasks || !ctx->deques) {
+      Ctx_free(ctx);
+      errno = ENOMEM;
+      return -1;
+    }
+    for (i = 0; i < bucket_count; i++) {
+      ctx->bucket_tasks[i].bucket = i;
+    }
+    // Room for the initial share of buckets, so seeding never grows
+    for (i = 0; i < thread_count; i++) {
+      if (Deque_init(&ctx->deques[i], bucket_count / thread_count + 64) != 0) {
+        Ctx_free(ctx);
+        errno = ENOMEM;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}  /* Ctx_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Report_stats
+ * Purpose:     Turn the bucket phase timestamps into busy/idle seconds;
+ *              a thread is idle from its own start until the last thread
+ *              finished, except while it was sorting
+ * In arg:      ctx
+ * Out arg:     stats (may be NULL)
+ */
+static void Report_stats(const sort_ctx *ctx, thread_stats *stats) {
+  double last = 0.0;
+  int i;
+
+  if (stats == NULL) {
+    return;
+  }
+  for (i = 0; i < ctx->thread_count; i++) {
+    last = ctx->times[i].end > last ? ctx->times[i].end : last;
+  }
+  for (i = 0; i < ctx->thread_count; i++) {
+    stats[i].busy = ctx->times[i].busy;
+    stats[i].idle = last - ctx->times[i].start - ctx->times[i].busy;
+  }
+}  /* Report_stats */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    sample_sort
+ * Purpose:     Sort data[0..n) ascending in place
+ * In arg:      n, opts (may be NULL for defaults)
+ * In/out arg:  data
+ * Return val:  0 on success, -1 with errno set on failure
+ */
+int sample_sort(int *data, size_t n, const sort_opts *opts) {
+  sort_opts defaults;
+  sort_ctx ctx;
+  sort_barrier barrier;
+  pthread_t *thread_handles;
+  thread_arg *args;
+  long thread, created;
+  int error = 0;
+
+  if (opts == NULL) {
+    Sort_opts_init(&defaults);
+    opts = &defaults;
+  }
+  if (n < 2) {
+    return 0;
+  }
+  if (Ctx_init(&ctx, data, n, opts, NULL, 0) != 0) {
+    return -1;
+  }
+  // pthread_barrier_init returns the error code, the others -1 and errno
+  error = Barrier_init(&barrier, ctx.thread_count);
+  if (error != 0) {
+    if (error == -1) {
+      error = errno;
+    }
+    Ctx_free(&ctx);
+    errno = error;
+    return -1;
+  }
+  ctx.barrier = &barrier;
+
+  // Parked pool workers skip thread creation altogether
+  if (opts->pool != NULL) {
+    Pool_run(opts->pool, ctx.thread_count, Pool_work, &ctx);
+    Barrier_destroy(&barrier);
+    Report_stats(&ctx, opts->stats);
+    Ctx_free(&ctx);
+    return 0;
+  }
+
+  thread_handles = malloc(ctx.thread_count * sizeof(pthread_t));
+  args = malloc(ctx.thread_count * sizeof(thread_arg));
+  if (!thread_handles || !args) {
+    free(thread_handles);
+    free(args);
+    Barrier_destroy(&barrier);
+    Ctx_free(&ctx);
+    errno = ENOMEM;
+    return -1;
+  }
+
+  for (thread = 0; thread < ctx.thread_count; thread++) {
+    args[thread].ctx = &ctx;
+    args[thread].rank = thread;
+  }
+  for (thread = 0; thread < ctx.thread_count; thread++) {
+    error = pthread_create(&thread_handles[thread], NULL,
+        Thread_work, &args[thread]);
+    if (error != 0) {
+      break;
+    }
+  }
+  // Release the threads, or tell the ones that started to give up
+  ctx.launch_failed = error != 0;
+  Dep_post(&ctx.deps.launched);
+
+  created = thread;
+  for (thread = 0; thread < created; thread++)
+     pthread_join(thread_handles[thread], NULL);
+
+  Barrier_destroy(&barrier);
+  if (error == 0) {
+    Report_stats(&ctx, opts->stats);
+  }
+  free(thread_handles);
+  free(args);
+  Ctx_free(&ctx);
+  if (error != 0) {
+    errno = error;
+    return -1;
+  }
+  return 0;
+}  /* sample_sort */
@@ -0,0 +1,119 @@
+/* File:       sample_sort.h
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Library interface of the Pthreads sample sort. Every call
+ *             keeps its whole state in a private context, so a process can
+ *             run any number of sorts back to back (or concurrently from
+ *             different threads) without global state.
+ *
+ * Usage:      sort_opts opts;
+ *             Sort_opts_init(&opts);
+ *             opts.thread_count = 8;
+ *             opts.pool = Pool_create(8);     // optional, reused by calls
+ *             if (sample_sort(data, n, &opts) != 0) perror("sample_sort");
+ */
+#ifndef _SAMPLE_SORT_H_
+#define _SAMPLE_SORT_H_
+
+#include <stddef.h>
+#include "thread_pool.h"
+
+// Sequential kernel used for a local chunk or a bucket
+typedef enum {
+  SORT_INTRO,          // Inlined introsort (local_sort.h)
+  SORT_RADIX,          // LSD radix sort (radix_sort.h)
+  SORT_RANGE,          // Radix narrowed to the keys' range, or a counting
+                       // sort when that range is small
+  SORT_MERGE           // Buckets only: loser-tree merge of the sorted runs
+                       // straight into the output (introsort for chunks)
+} sort_kernel;
+
+// How each thread splits its chunk of the input into buckets
+typedef enum {
+  PARTITION_SORTED,    // Sort the chunk, then walk it against the splitters
+  PARTITION_CLASSIFY,  // Classify the unsorted chunk through a branch-free
+                       // splitter tree (classifier.h); no local sort
+  PARTITION_EXACT,     // Sort the chunk, then cut the sorted chunks at
+                       // exact ranks by multi-sequence selection: every
+                       // bucket holds n/bucket_count keys (give or take
+                       // one) and no sample is drawn
+  PARTITION_INPLACE    // Classify into per-thread buffer blocks and permute
+                       // the blocks within the input (IPS4o); no tmp_list,
+                       // O(thread_count * bucket_count) blocks of extra
+                       // memory. Uses random sampling and introsort
+} partition_mode;
+
+// How each thread picks its sample keys
+typedef enum {
+  SAMPLE_RANDOM,       // Random positions of the unsorted chunk
+  SAMPLE_REGULAR       // Parallel Sorting by Regular Sampling: evenly
+                       // spaced positions of the sorted chunk. With at
+                       // least thread_count samples per thread and
+                       // distinct keys, no bucket exceeds 2n/p. Turns
+                       // PARTITION_CLASSIFY into PARTITION_SORTED
+} sample_mode;
+
+// How PARTITION_CLASSIFY writes each key to its bucket
+typedef enum {
+  SCATTER_PLAIN,       // One ordinary store per key
+  SCATTER_STREAM       // Stage a cache line per bucket and write full
+                       // lines with non-temporal stores (write_combine.h);
+                       // pays off once the list is much larger than the
+                       // last level cache
+} scatter_mode;
+
+// How the threads share out the bucket sorts
+typedef enum {
+  SCHEDULE_QUEUE,      // Pull buckets from one shared queue, largest first
+  SCHEDULE_STEAL       // Per-thread work-stealing deques (ws_deque.h); big
+                       // introsort buckets are split into stealable parts
+} bucket_schedule;
+
+// Where one thread's time went during the bucket phase
+typedef struct {
+  double busy;         // Seconds spent sorting buckets
+  double idle;         // Seconds of the phase spent without work
+} thread_stats;
+
+typedef struct {
+  int thread_count;    // Number of worker threads
+  int bucket_count;    // Buckets the threads pull from a shared queue,
+                       // largest first; 0 means one per thread. A few
+                       // times thread_count evens out skewed inputs
+  int sample_size;     // Total number of sample keys, split among threads;
+                       // raised to at least bucket_count
+  thread_pool *pool;   // Persistent workers to run on, NULL spawns threads
+                       // per call; thread_count is capped at its size
+  sort_kernel local_kernel;   // Sorts each thread's chunk of the input
+  sort_kernel bucket_kernel;  // Sorts (or merges) each bucket; runs are
+                              // unsorted under PARTITION_CLASSIFY, where
+                              // SORT_MERGE falls back to introsort
+  partition_mode partition;
+  sample_mode sampling;
+  bucket_schedule schedule;
+  thread_stats *stats; // Optional, receives one entry per thread used
+  size_t nested_threshold;  // Buckets above this many keys are sample
+                            // sorted again by all threads together; 0 is
+                            // twice an even share, SIZE_MAX disables it
+  scatter_mode scatter;
+  unsigned long long seed;  // Seeds every thread's sampling stream (rng.h);
+                            // the same seed gives the same samples
+} sort_opts;
+
+/*--------------------------------------------------------------------
+ * Function:    Sort_opts_init
+ * Purpose:     Fill opts with the defaults used when sample_sort gets NULL
+ * Out arg:     opts
+ */
+void Sort_opts_init(sort_opts *opts);
+
+/*--------------------------------------------------------------------
+ * Function:    sample_sort
+ * Purpose:     Sort data[0..n) ascending in place
+ * In arg:      n, opts (may be NULL for defaults)
+ * In/out arg:  data
+ * Return val:  0 on success, -1 with errno set on failure
+ */
+int sample_sort(int *data, size_t n, const sort_opts *opts);
+
+#endif
@@ -0,0 +1,225 @@
+/* File:       scan.h
+ *
+ * Purpose:    Parallel exclusive prefix sums of size_t arrays, run by a
+ *             team of threads (typically the ranks of a pool task):
+ *             out[i] = in[0] + ... + in[i-1] for 0 <= i <= n, so out has
+ *             n + 1 entries and out[n] receives the total. in and out may
+ *             be the same array.
+ *
+ * Note:       Each state serves one scan. A thread returning from a scan
+ *             has finished its own share only; callers that read out
+ *             afterwards must first know that every caller has returned.
+ *
+ * Example:
+ *    blocked_scan b;                        lookback_scan l;
+ *    Blocked_scan_init(&b, p);              Lookback_scan_init(&l, n, SCAN_TILE);
+ *    Blocked_scan(&b, in, out, n, rank);    Lookback_scan(&l, in, out, n);
+ *    Blocked_scan_free(&b);                 Lookback_scan_free(&l);
+ *
+ * Algorithm:  Blocked_scan is the classic two-pass scan: every rank sums
+ *             its block and posts it, then turns its block into prefix
+ *             sums starting from the sum of the earlier blocks. It must be
+ *             called by exactly ranks 0..p-1.
+ *
+ *             Lookback_scan is the single-pass decoupled look-back scan
+ *             of Merrill and Garland ("Single-pass Parallel Prefix Scan
+ *             with Decoupled Look-back", NVIDIA NVR-2016-002). Callers
+ *             claim tiles in order; each publishes its tile's sum, then
+ *             walks back over its predecessors adding their sums until it
+ *             meets one whose inclusive prefix is already known. Any
+ *             number of threads may call it, arriving at any time, and
+ *             the input is read only once.
+ */
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "spin.h"
+
+// Default elements per look-back tile
+#define SCAN_TILE 4096
+
+typedef struct {
+  size_t *block_sums;    // One per rank
+  atomic_int posted;     // Ranks whose block sum is in
+  int thread_count;
+} blocked_scan;
+
+// A tile's published state: nothing yet, its own sum, or its inclusive
+// prefix; the values are written before the status that announces them
+enum { TILE_EMPTY, TILE_AGGREGATE, TILE_PREFIX };
+
+typedef struct {
+  _Alignas(CACHE_LINE) atomic_int status;
+  size_t aggregate, prefix;
+} scan_tile;
+
+typedef struct {
+  scan_tile *tiles;
+  size_t tile_size, tile_count;
+  atomic_size_t next_tile;
+} lookback_scan;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Blocked_scan_init
+ * Purpose:     Set up a two-pass scan for thread_count ranks
+ * In arg:      thread_count
+ * Out arg:     s
+ * Return val:  0 on success, -1 if the block sums could not be allocated
+ */
+static inline int Blocked_scan_init(blocked_scan *s, int thread_count) {
+  s->block_sums = malloc(thread_count * sizeof(size_t));
+  s->thread_count = thread_count;
+  atomic_init(&s->posted, 0);
+  return s->block_sums != NULL ? 0 : -1;
+}  /* Blocked_scan_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Blocked_scan_free
+ * Purpose:     Release a two-pass scan
+ * In arg:      s
+ */
+static inline void Blocked_scan_free(blocked_scan *s) {
+  free(s->block_sums);
+  s->block_sums = NULL;
+}  /* Blocked_scan_free */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Blocked_scan
+ * Purpose:     One rank's share of a two-pass exclusive scan
+ * In arg:      in, n, rank
+ * In/out arg:  s
+ * Out arg:     out (this rank's block, and out[n] on the last rank)
+ */
+static inline void Blocked_scan(blocked_scan *s, const size_t *in, size_t *out,
+    size_t n, int rank) {
+  size_t first = (size_t) rank * n / s->thread_count;
+  size_t last = (size_t) (rank + 1) * n / s->thread_count;
+  size_t sum = 0, x, i;
+  int t;
+
+  for (i = first; i < last; i++) {
+    sum += in[i];
+  }
+  s->block_sums[rank] = sum;
+  atomic_fetch_add_explicit(&s->posted, 1, memory_order_release);
+
+  Spin_wait_at_least(&s->posted, s->thread_count);
+  sum = 0;
+  for (t = 0; t < rank; t++) {
+    sum += s->block_sums[t];
+  }
+  for (i = first; i < last; i++) {
+    x = in[i];
+    out[i] = sum;
+    sum += x;
+  }
+  if (rank == s->thread_count - 1) {
+    out[n] = sum;
+  }
+}  /* Blocked_scan */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Lookback_scan_init
+ * Purpose:     Set up a look-back scan of n elements
+ * In arg:      n, tile_size
+ * Out arg:     s
+ * Return val:  0 on success, -1 if the tiles could not be allocated
+ */
+static inline int Lookback_scan_init(lookback_scan *s, size_t n, size_t tile_size) {
+  size_t t;
+
+  s->tile_size = tile_size > 0 ? tile_size : SCAN_TILE;
+  // An empty input still has a tile, the one that writes out[0]
+  s->tile_count = n == 0 ? 1 : (n + s->tile_size - 1) / s->tile_size;
+  s->tiles = aligned_alloc(_Alignof(scan_tile), s->tile_count * sizeof(scan_tile));
+  if (s->tiles == NULL) {
+    return -1;
+  }
+  for (t = 0; t < s->tile_count; t++) {
+    atomic_init(&s->tiles[t].status, TILE_EMPTY);
+  }
+  atomic_init(&s->next_tile, 0);
+  return 0;
+}  /* Lookback_scan_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Lookback_scan_free
+ * Purpose:     Release a look-back scan
+ * In arg:      s
+ */
+static inline void Lookback_scan_free(lookback_scan *s) {
+  free(s->tiles);
+  s->tiles = NULL;
+}  /* Lookback_scan_free */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Lookback_scan
+ * Purpose:     Claim and scan tiles until none is left
+ * In arg:      in, n (the n given to Lookback_scan_init)
+ * In/out arg:  s
+ * Out arg:     out (the claimed tiles, and out[n] with the last tile)
+ * Note:        Tiles are claimed in increasing order and each is finished
+ *              before the next is claimed, so every predecessor a caller
+ *              waits on belongs to a thread that is already working on it.
+ */
+static inline void Lookback_scan(lookback_scan *s, const size_t *in, size_t *out,
+    size_t n) {
+  size_t t, j, first, last, i, sum, exclusive, x;
+  scan_tile *tile;
+  unsigned polls;
+  int status;
+
+  while ((t = atomic_fetch_add(&s->next_tile, 1)) < s->tile_count) {
+    tile = &s->tiles[t];
+    first = t * s->tile_size;
+    last = first + s->tile_size < n ? first + s->tile_size : n;
+    sum = 0;
+    for (i = first; i < last; i++) {
+      sum += in[i];
+    }
+
+    exclusive = 0;
+    if (t > 0) {
+      tile->aggregate = sum;
+      atomic_store_explicit(&tile->status, TILE_AGGREGATE, memory_order_release);
+      for (j = t; j-- > 0; ) {
+        polls = 0;
+        while ((status = atomic_load_explicit(&s->tiles[j].status,
+            memory_order_acquire)) == TILE_EMPTY) {
+          Spin_pause(&polls);
+        }
+        if (status == TILE_PREFIX) {
+          exclusive += s->tiles[j].prefix;
+          break;
+        }
+        exclusive += s->tiles[j].aggregate;
+      }
+    }
+    tile->prefix = exclusive + sum;
+    atomic_store_explicit(&tile->status, TILE_PREFIX, memory_order_release);
+
+    for (i = first; i < last; i++) {
+      x = in[i];
+      out[i] = exclusive;
+      exclusive += x;
+    }
+    if (last == n) {
+      out[n] = exclusive;
+    }
+  }
+}  /* Lookback_scan */
+
+#endif
@@ -0,0 +1,63 @@
+/* File:       spin.h
+ *
+ * Purpose:    What every busy-wait of the sort shares: the cache line
+ *             size that keeps words written by different threads apart,
+ *             a pause hint for the body of a polling loop, and how often
+ *             such a loop gives the core away in case it is shared.
+ *
+ * Example:
+ *    unsigned polls = 0;
+ *    while (!Ready(x)) Spin_pause(&polls);
+ *
+ *    Spin_wait_at_least(&count, target);   // acquires what was posted
+ */
+#ifndef _SPIN_H_
+#define _SPIN_H_
+
+#include <sched.h>
+#include <stdatomic.h>
+
+// Bytes per cache line, for keeping thread-private data apart
+#define CACHE_LINE 64
+// Polls of a busy-wait between yields of the core
+#define SPIN_YIELD_EVERY 64
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() ((void) 0)
+#endif
+
+
+/*--------------------------------------------------------------------
+ * Function:    Spin_pause
+ * Purpose:     Back off after one unsuccessful poll: pause the core, or
+ *              every SPIN_YIELD_EVERY-th poll yield it
+ * In/out arg:  polls (0 before the first poll of a wait; unsigned so a
+ *              long wait wraps it instead of overflowing)
+ */
+static inline void Spin_pause(unsigned *polls) {
+  if (++*polls % SPIN_YIELD_EVERY == 0) {
+    sched_yield();
+  } else {
+    CPU_RELAX();
+  }
+}  /* Spin_pause */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Spin_wait_at_least
+ * Purpose:     Wait until *word reaches at least target, after which
+ *              everything released with the increments is visible
+ * In arg:      word, target
+ */
+static inline void Spin_wait_at_least(atomic_int *word, int target) {
+  unsigned polls = 0;
+
+  while (atomic_load_explicit(word, memory_order_acquire) < target) {
+    Spin_pause(&polls);
+  }
+}  /* Spin_wait_at_least */
+
+#endif
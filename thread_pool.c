@@ -0,0 +1,281 @@
+/* File:       thread_pool.c
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    Persistent worker pool declared in thread_pool.h.
+ *
+ * Compile:    gcc -g -Wall -c thread_pool.c
+ *
+ * Algorithm:  A job is published by filling task/arg/active and bumping
+ *             the generation counter. Workers wait for the generation to
+ *             change: first by spinning, then by sleeping on the wake
+ *             condition once they have advertised themselves in
+ *             sleepers. Every worker acknowledges every generation through
+ *             pending, whether or not its rank takes part, so the job
+ *             fields are never rewritten while a worker still reads them.
+ *             The same spin-then-sleep wait is used by the caller for
+ *             pending to reach zero.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "thread_pool.h"
+#include "spin.h"
+
+// Iterations a parked thread polls before it goes to sleep
+#define POOL_SPIN 20000
+
+struct thread_pool {
+  pthread_t *handles;
+  int thread_count;            // Workers plus the calling thread
+  pthread_mutex_t run_lock;    // Serializes Pool_run callers
+  pthread_mutex_t lock;        // Protects the sleeping paths only
+  pthread_cond_t wake, done;
+  atomic_uint generation;      // Bumped once per published job
+  atomic_int pending;          // Workers yet to finish the current job
+  atomic_int sleepers;         // Workers blocked on wake
+  atomic_int caller_sleeping;  // Caller blocked on done
+  pool_task task;
+  void *arg;
+  int active;                  // Ranks taking part in the current job
+  int shutdown;
+};
+
+// Argument handed to each worker
+typedef struct {
+  thread_pool *pool;
+  int rank;
+} worker_arg;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wait_generation
+ * Purpose:     Park until the pool generation differs from seen
+ * In arg:      pool, seen
+ * Return val:  The new generation
+ */
+static unsigned Wait_generation(thread_pool *pool, unsigned seen) {
+  unsigned gen, polls = 0;
+  int i;
+
+  for (i = 0; i < POOL_SPIN; i++) {
+    gen = atomic_load_explicit(&pool->generation, memory_order_acquire);
+    if (gen != seen) {
+      return gen;
+    }
+    Spin_pause(&polls);
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  atomic_fetch_add(&pool->sleepers, 1);
+  while ((gen = atomic_load(&pool->generation)) == seen) {
+    pthread_cond_wait(&pool->wake, &pool->lock);
+  }
+  atomic_fetch_sub(&pool->sleepers, 1);
+  pthread_mutex_unlock(&pool->lock);
+  return gen;
+}  /* Wait_generation */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wait_done
+ * Purpose:     Park the caller until every worker acknowledged the job
+ * In arg:      pool
+ */
+static void Wait_done(thread_pool *pool) {
+  unsigned polls = 0;
+  int i;
+
+  for (i = 0; i < POOL_SPIN; i++) {
+    if (atomic_load_explicit(&pool->pending, memory_order_acquire) == 0) {
+      return;
+    }
+    Spin_pause(&polls);
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  atomic_store(&pool->caller_sleeping, 1);
+  while (atomic_load(&pool->pending) != 0) {
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  atomic_store(&pool->caller_sleeping, 0);
+  pthread_mutex_unlock(&pool->lock);
+}  /* Wait_done */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Worker_loop
+ * Purpose:     Body of a pooled thread: wait, run own rank, acknowledge
+ * In arg:      arg (worker_arg)
+ * Return val:  Ignored
+ */
+static void *Worker_loop(void *arg) {
+  thread_pool *pool = ((worker_arg *) arg)->pool;
+  int rank = ((worker_arg *) arg)->rank;
+  unsigned seen = 0;
+
+  free(arg);
+  for (;;) {
+    seen = Wait_generation(pool, seen);
+    if (pool->shutdown) {
+      break;
+    }
+    if (rank < pool->active) {
+      pool->task(pool->arg, rank);
+    }
+    if (atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_acq_rel) == 1
+        && atomic_load(&pool->caller_sleeping)) {
+      pthread_mutex_lock(&pool->lock);
+      pthread_cond_signal(&pool->done);
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+  return NULL;
+}  /* Worker_loop */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Publish
+ * Purpose:     Release a new generation and wake sleeping workers
+ * In arg:      pool
+ */
+static void Publish(thread_pool *pool) {
+  atomic_store(&pool->pending, pool->thread_count - 1);
+  atomic_fetch_add(&pool->generation, 1);
+  // Pairs with the sleepers increment in Wait_generation: either the
+  // worker sees the new generation or we see it asleep
+  if (atomic_load(&pool->sleepers) > 0) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}  /* Publish */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_create
+ * Purpose:     Start a pool serving up to thread_count ranks
+ * In arg:      thread_count
+ * Return val:  The pool, or NULL with errno set
+ */
+thread_pool *Pool_create(int thread_count) {
+  thread_pool *pool;
+  worker_arg *warg;
+  int rank;
+
+  if (thread_count < 1) {
+    errno = EINVAL;
+    return NULL;
+  }
+  pool = calloc(1, sizeof(thread_pool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->handles = malloc(thread_count * sizeof(pthread_t));
+  if (pool->handles == NULL) {
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->run_lock, NULL);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  atomic_init(&pool->generation, 0);
+  atomic_init(&pool->pending, 0);
+  atomic_init(&pool->sleepers, 0);
+  atomic_init(&pool->caller_sleeping, 0);
+
+  // Rank 0 is whoever calls Pool_run
+  pool->thread_count = 1;
+  for (rank = 1; rank < thread_count; rank++) {
+    warg = malloc(sizeof(worker_arg));
+    if (warg == NULL) {
+      break;
+    }
+    warg->pool = pool;
+    warg->rank = rank;
+    if (pthread_create(&pool->handles[rank], NULL, Worker_loop, warg) != 0) {
+      free(warg);
+      break;
+    }
+    pool->thread_count++;
+  }
+  if (pool->thread_count < thread_count) {
+    Pool_destroy(pool);
+    errno = EAGAIN;
+    return NULL;
+  }
+  return pool;
+}  /* Pool_create */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_size
+ * Purpose:     Number of ranks the pool can run at once
+ * In arg:      pool
+ */
+int Pool_size(const thread_pool *pool) {
+  return pool->thread_count;
+}  /* Pool_size */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_run
+ * Purpose:     Run task(arg, rank) for rank in [0, thread_count) and wait
+ * In arg:      pool, thread_count, task, arg
+ */
+void Pool_run(thread_pool *pool, int thread_count, pool_task task, void *arg) {
+  if (thread_count > pool->thread_count) {
+    thread_count = pool->thread_count;
+  }
+  if (thread_count <= 1) {
+    task(arg, 0);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->run_lock);
+  pool->task = task;
+  pool->arg = arg;
+  pool->active = thread_count;
+  Publish(pool);
+
+  task(arg, 0);
+  Wait_done(pool);
+  pthread_mutex_unlock(&pool->run_lock);
+}  /* Pool_run */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_destroy
+ * Purpose:     Stop and join all workers, then free the pool
+ * In arg:      pool
+ */
+void Pool_destroy(thread_pool *pool) {
+  int rank;
+
+  if (pool == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&pool->run_lock);
+  pool->shutdown = 1;
+  Publish(pool);
+  for (rank = 1; rank < pool->thread_count; rank++) {
+    pthread_join(pool->handles[rank], NULL);
+  }
+  pthread_mutex_unlock(&pool->run_lock);
+
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_mutex_destroy(&pool->run_lock);
+  free(pool->handles);
+  free(pool);
+}  /* Pool_destroy */
@@ -0,0 +1,57 @@
+/* File:       thread_pool.h
+ * Author:     Vincent Zhang
+ *
+ * Purpose:    A persistent pool of parked worker threads. Pool_run hands
+ *             one task to ranks 0..thread_count-1 and returns when all of
+ *             them have finished; the calling thread always runs rank 0,
+ *             so a pool of p threads keeps p-1 workers alive.
+ *
+ * Note:       Parked workers spin for a short while before sleeping on a
+ *             condition variable, so back to back runs wake them in
+ *             microseconds instead of paying pthread_create/join.
+ *
+ * Example:
+ *    thread_pool *pool = Pool_create(8);
+ *    . . .
+ *    Pool_run(pool, 8, Task, arg);     // Task(arg, rank) on 8 ranks
+ *    . . .
+ *    Pool_destroy(pool);
+ */
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+typedef struct thread_pool thread_pool;
+typedef void (*pool_task)(void *arg, int rank);
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_create
+ * Purpose:     Start a pool serving up to thread_count ranks
+ * In arg:      thread_count
+ * Return val:  The pool, or NULL with errno set
+ */
+thread_pool *Pool_create(int thread_count);
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_size
+ * Purpose:     Number of ranks the pool can run at once
+ * In arg:      pool
+ */
+int Pool_size(const thread_pool *pool);
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_run
+ * Purpose:     Run task(arg, rank) for rank in [0, thread_count) and wait;
+ *              thread_count is capped at Pool_size. Concurrent callers
+ *              are served one after another.
+ * In arg:      pool, thread_count, task, arg
+ */
+void Pool_run(thread_pool *pool, int thread_count, pool_task task, void *arg);
+
+/*--------------------------------------------------------------------
+ * Function:    Pool_destroy
+ * Purpose:     Stop and join all workers, then free the pool
+ * In arg:      pool
+ */
+void Pool_destroy(thread_pool *pool);
+
+#endif
@@ -0,0 +1,167 @@
+/* File:       write_combine.h
+ *
+ * Purpose:    Software write-combining for scattering int keys to many
+ *             destination streams: each stream stages its keys in a
+ *             cache-line sized buffer and full lines go out at once, with
+ *             non-temporal (streaming) stores where SSE2 is available.
+ *
+ * Note:       A line is only streamed when every index in it belongs to
+ *             the stream, since a streamed line replaces the whole line;
+ *             the partial lines at both ends of a stream, which may be
+ *             shared with another thread's stream, use plain stores.
+ *             Wc_flush must run before anyone reads the destination.
+ *
+ * Example:
+ *    wc_buffers wc;
+ *    Wc_init(&wc, dest, next, stream_count);   // next[s]: first index of s
+ *    Wc_put(&wc, s, key);                      // append key to stream s
+ *    Wc_flush(&wc);
+ *    Wc_free(&wc);
+ *
+ * Algorithm:  Lines are counted from the destination's real address, so
+ *             a key at dest[i] lands in slot (phase + i) % WC_LINE of its
+ *             stream's buffer, where phase is dest's offset, in ints, from
+ *             the previous CACHE_LINE boundary. Filling the last slot
+ *             completes a line.
+ */
+#ifndef _WRITE_COMBINE_H_
+#define _WRITE_COMBINE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spin.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define WC_LINE ((int) (CACHE_LINE / sizeof(int)))
+
+typedef struct {
+  int *dest;
+  size_t phase;          // Ints from the line boundary before dest to dest
+  int *lines;            // stream_count lines of WC_LINE keys, line aligned
+  size_t *pos;           // Next destination index of each stream
+  size_t *begin;         // First destination index of each stream
+  int stream_count;
+} wc_buffers;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wc_init
+ * Purpose:     Set up one staging line per stream
+ * In arg:      dest, next (first destination index of every stream),
+ *              stream_count
+ * Out arg:     wc
+ * Return val:  0 on success, -1 if the buffers could not be allocated
+ */
+static int Wc_init(wc_buffers *wc, int *dest, const size_t *next, int stream_count) {
+  wc->dest = dest;
+  wc->phase = ((uintptr_t) dest % CACHE_LINE) / sizeof(int);
+  wc->stream_count = stream_count;
+  wc->lines = aligned_alloc(CACHE_LINE, (size_t) stream_count * CACHE_LINE);
+  wc->pos = malloc(stream_count * sizeof(size_t));
+  wc->begin = malloc(stream_count * sizeof(size_t));
+  if (wc->lines == NULL || wc->pos == NULL || wc->begin == NULL) {
+    free(wc->lines);
+    free(wc->pos);
+    free(wc->begin);
+    return -1;
+  }
+  memcpy(wc->pos, next, stream_count * sizeof(size_t));
+  memcpy(wc->begin, next, stream_count * sizeof(size_t));
+  return 0;
+}  /* Wc_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wc_free
+ * Purpose:     Release the staging lines
+ * In arg:      wc
+ */
+static void Wc_free(wc_buffers *wc) {
+  free(wc->lines);
+  free(wc->pos);
+  free(wc->begin);
+}  /* Wc_free */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wc_store_line
+ * Purpose:     Write one whole, line aligned line with streaming stores
+ * In arg:      line
+ * Out arg:     to
+ */
+static inline void Wc_store_line(int *to, const int *line) {
+#if defined(__SSE2__)
+  int i;
+
+  for (i = 0; i < WC_LINE; i += 4) {
+    _mm_stream_si128((__m128i *) (to + i), _mm_load_si128((const __m128i *) (line + i)));
+  }
+#else
+  memcpy(to, line, CACHE_LINE);
+#endif
+}  /* Wc_store_line */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wc_put
+ * Purpose:     Append key to a stream, writing out its line once full
+ * In arg:      stream, key
+ * In/out arg:  wc
+ */
+static inline void Wc_put(wc_buffers *wc, int stream, int key) {
+  int *line = wc->lines + (size_t) stream * WC_LINE;
+  size_t pos = wc->pos[stream]++;
+  size_t slot = (wc->phase + pos) % WC_LINE;
+  size_t start;
+
+  line[slot] = key;
+  if (slot == WC_LINE - 1) {
+    start = pos + 1 - WC_LINE;
+    if (pos + 1 >= WC_LINE && start >= wc->begin[stream]) {
+      Wc_store_line(wc->dest + start, line);
+    } else {
+      // First line of the stream, starting part way in
+      start = wc->begin[stream];
+      memcpy(wc->dest + start, line + (wc->phase + start) % WC_LINE,
+          (pos + 1 - start) * sizeof(int));
+    }
+  }
+}  /* Wc_put */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Wc_flush
+ * Purpose:     Write out every partly filled line and order the streamed
+ *              stores before whatever the caller does next
+ * In/out arg:  wc
+ */
+static void Wc_flush(wc_buffers *wc) {
+  size_t pos, start, slot;
+  int s;
+
+  for (s = 0; s < wc->stream_count; s++) {
+    pos = wc->pos[s];
+    slot = (wc->phase + pos) % WC_LINE;
+    if (slot == 0) {
+      continue;
+    }
+    start = pos - slot;
+    if (pos < slot || start < wc->begin[s]) {
+      start = wc->begin[s];
+    }
+    memcpy(wc->dest + start, wc->lines + (size_t) s * WC_LINE + (wc->phase + start) % WC_LINE,
+        (pos - start) * sizeof(int));
+  }
+#if defined(__SSE2__)
+  _mm_sfence();
+#endif
+}  /* Wc_flush */
+
+#endif
@@ -0,0 +1,208 @@
+/* File:       ws_deque.h
+ *
+ * Purpose:    Lock-free Chase-Lev work-stealing deque of pointers. The
+ *             owning thread pushes and pops at the bottom; any other
+ *             thread may steal from the top.
+ *
+ * Note:       Deque_steal returns NULL both when the deque is empty and
+ *             when it lost a race for the top item; thieves simply try
+ *             again or move on to another victim.
+ *
+ * Example:
+ *    ws_deque d;
+ *    Deque_init(&d, 64);
+ *    Deque_push(&d, task);            // owner only
+ *    task = Deque_pop(&d);            // owner only
+ *    task = Deque_steal(&d);          // any thread
+ *    Deque_free(&d);
+ *
+ * Algorithm:  Chase and Lev, "Dynamic Circular Work-Stealing Deque"
+ *             (SPAA 2005), with the C11 memory orderings of Le, Pop,
+ *             Cohen and Zappa Nardelli, "Correct and Efficient
+ *             Work-Stealing for Weak Memory Models" (PPoPP 2013). A full
+ *             circular array is replaced by one of twice the size; old
+ *             arrays stay alive until Deque_free because a thief may
+ *             still be reading them.
+ */
+#ifndef _WS_DEQUE_H_
+#define _WS_DEQUE_H_
+
+#include <stdlib.h>
+#include <stdatomic.h>
+
+typedef struct ws_array {
+  long size;                   // Power of two
+  _Atomic(void *) *slots;
+  struct ws_array *prev;       // Retired smaller arrays
+} ws_array;
+
+typedef struct {
+  atomic_long top, bottom;
+  _Atomic(ws_array *) array;
+} ws_deque;
+
+
+/*--------------------------------------------------------------------
+ * Function:    Array_new
+ * Purpose:     Allocate a circular array of size slots
+ * In arg:      size, prev
+ * Return val:  The array, or NULL
+ */
+static ws_array *Array_new(long size, ws_array *prev) {
+  ws_array *a = malloc(sizeof(ws_array));
+
+  if (a == NULL) {
+    return NULL;
+  }
+  a->slots = malloc(size * sizeof(_Atomic(void *)));
+  if (a->slots == NULL) {
+    free(a);
+    return NULL;
+  }
+  a->size = size;
+  a->prev = prev;
+  return a;
+}  /* Array_new */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Deque_init
+ * Purpose:     Set up an empty deque
+ * In arg:      capacity (rounded up to a power of two)
+ * Out arg:     d
+ * Return val:  0 on success, -1 if the array could not be allocated
+ */
+static int Deque_init(ws_deque *d, long capacity) {
+  long size = 1;
+  ws_array *a;
+
+  while (size < capacity) {
+    size <<= 1;
+  }
+  a = Array_new(size, NULL);
+  if (a == NULL) {
+    return -1;
+  }
+  atomic_init(&d->top, 0);
+  atomic_init(&d->bottom, 0);
+  atomic_init(&d->array, a);
+  return 0;
+}  /* Deque_init */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Deque_free
+ * Purpose:     Release the current and every retired array
+ * In arg:      d
+ */
+static void Deque_free(ws_deque *d) {
+  ws_array *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+  ws_array *prev;
+
+  while (a != NULL) {
+    prev = a->prev;
+    free(a->slots);
+    free(a);
+    a = prev;
+  }
+  atomic_store_explicit(&d->array, NULL, memory_order_relaxed);
+}  /* Deque_free */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Deque_push
+ * Purpose:     Owner adds an item at the bottom, growing when full
+ * In arg:      d, item
+ * Return val:  0 on success, -1 if a larger array could not be allocated
+ */
+static int Deque_push(ws_deque *d, void *item) {
+  long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+  long t = atomic_load_explicit(&d->top, memory_order_acquire);
+  ws_array *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+  ws_array *grown;
+  long i;
+
+  if (b - t > a->size - 1) {
+    grown = Array_new(2 * a->size, a);
+    if (grown == NULL) {
+      return -1;
+    }
+    for (i = t; i < b; i++) {
+      atomic_store_explicit(&grown->slots[i & (grown->size - 1)],
+          atomic_load_explicit(&a->slots[i & (a->size - 1)], memory_order_relaxed),
+          memory_order_relaxed);
+    }
+    atomic_store_explicit(&d->array, grown, memory_order_release);
+    a = grown;
+  }
+  atomic_store_explicit(&a->slots[b & (a->size - 1)], item, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  return 0;
+}  /* Deque_push */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Deque_pop
+ * Purpose:     Owner takes the most recently pushed item
+ * In arg:      d
+ * Return val:  The item, or NULL when empty
+ */
+static void *Deque_pop(ws_deque *d) {
+  long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+  ws_array *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+  long t;
+  void *item = NULL;
+
+  atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  t = atomic_load_explicit(&d->top, memory_order_relaxed);
+  if (t <= b) {
+    item = atomic_load_explicit(&a->slots[b & (a->size - 1)], memory_order_relaxed);
+    if (t == b) {
+      // Last item: race the thieves for it
+      if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+          memory_order_seq_cst, memory_order_relaxed)) {
+        item = NULL;
+      }
+      atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+  } else {
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  }
+  return item;
+}  /* Deque_pop */
+
+
+
+/*--------------------------------------------------------------------
+ * Function:    Deque_steal
+ * Purpose:     Any thread takes the oldest item
+ * In arg:      d
+ * Return val:  The item, or NULL when empty or the race was lost
+ */
+static void *Deque_steal(ws_deque *d) {
+  long t = atomic_load_explicit(&d->top, memory_order_acquire);
+  long b;
+  ws_array *a;
+  void *item;
+
+  atomic_thread_fence(memory_order_seq_cst);
+  b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+  if (t >= b) {
+    return NULL;
+  }
+  a = atomic_load_explicit(&d->array, memory_order_acquire);
+  item = atomic_load_explicit(&a->slots[t & (a->size - 1)], memory_order_relaxed);
+  if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+      memory_order_seq_cst, memory_order_relaxed)) {
+    return NULL;
+  }
+  return item;
+}  /* Deque_steal */
+
+#endif